@@ -2,7 +2,7 @@
 --
 -- *Dependencies:* `os`, `sdl_logger`, `atf.util`, `ATF`
 --
--- *Globals:* `sleep()`, `CopyFile()`, `CopyInterface()`, `xmlReporter`, `console`, `config`
+-- *Globals:* `sleep()`, `CopyFile()`, `CopyInterface()`, `xmlReporter`, `console`, `config`, `process`, `network`, `qt`, `timers`
 -- @module SDL
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -31,6 +31,14 @@ SDL.CRASH = -1
 --- SDL state constant: SDL in idle mode (for remote only)
 SDL.IDLE = -2
 
+--[[ Local Variables ]]
+--- File with pid of SDL started locally
+local pidFile = "sdl.pid"
+--- Time to wait for SDL to stop correctly before aborting it (ms)
+local shutdownTimeout = 5000
+--- SDL process started locally (process.Process)
+local sdlProcess = nil
+
 --[[ Local Functions ]]
 local function getPath(pPath, pParentPath)
   if pParentPath == nil then pParentPath = config.pathToSDL end
@@ -246,6 +254,79 @@ local function backup(pFilePath)
   end
 end
 
+--- Get SDL process started locally by this or previous ATF run
+-- @treturn userdata SDL process (process.Process) or nil if there is no running SDL
+local function getLocalSDLProcess()
+  if sdlProcess == nil then
+    local file = io.open(pidFile, "r")
+    if file then
+      local pid = tonumber(file:read("*l"))
+      file:close()
+      if pid then sdlProcess = process.attach(pid) end
+    end
+  end
+  return sdlProcess
+end
+
+--- Start SDL locally and store its pid
+-- @tparam string pPathToSDL Path to SDL
+-- @tparam string pSDLName The name of the SDL to run
+-- @treturn boolean Indicates whether SDL is started
+local function startLocalSDL(pPathToSDL, pSDLName)
+  local sdl, err = process.spawn("./" .. pSDLName, {}, {
+      cwd = pPathToSDL,
+      env = { LD_LIBRARY_PATH = (os.getenv("LD_LIBRARY_PATH") or "") .. ":." },
+      stdout = "/dev/null"
+    })
+  if not sdl then
+    print(err)
+    return false
+  end
+  print("SDL pid " .. sdl:pid())
+  if not sdl:running() then return false end
+  local file = io.open(pidFile, "w")
+  file:write(sdl:pid() .. "\n")
+  file:close()
+  sdlProcess = sdl
+  return true
+end
+
+--- Wait for exit of the process
+-- Event loop keeps running if the caller is a coroutine started by async() (e.g. a test step),
+-- otherwise ATF is blocked
+-- @tparam userdata pProcess Process (process.Process)
+-- @tparam number pTimeout Time to wait (ms)
+-- @treturn boolean Indicates whether the process has finished
+local function waitForExit(pProcess, pTimeout)
+  if not pProcess:running() then return true end
+  if timers.isAsync() then
+    return timers.waitFor(pProcess, "finished(int,int)", pTimeout)
+  end
+  return pProcess:wait(pTimeout)
+end
+
+--- Stop SDL started locally (SIGINT is used, SIGABRT in case SDL has not stopped in time)
+local function stopLocalSDL()
+  local sdl = getLocalSDLProcess()
+  if sdl and sdl:kill(process.SIGINT) and not waitForExit(sdl, shutdownTimeout) then
+    print("Unable to stop SDL correctly during " .. shutdownTimeout / 1000 .. " seconds")
+    print("Kill SDL process : " .. sdl:pid())
+    sdl:kill(process.SIGABRT)
+    waitForExit(sdl, shutdownTimeout)
+  end
+  SDL.DeleteFile()
+end
+
+--- Kill all SDL processes (SIGKILL is used)
+local function killLocalSDL()
+  local sdl = sdlProcess
+  if sdl and sdl:kill(process.SIGKILL) then waitForExit(sdl, shutdownTimeout) end
+  for _, pid in ipairs(process.find(config.SDL)) do
+    sdl = process.attach(pid)
+    if sdl and sdl:kill(process.SIGKILL) then waitForExit(sdl, shutdownTimeout) end
+  end
+end
+
 --- Structure of SDL build options what to be set
 local function getDefaultBuildOptions()
   local options = { }
@@ -616,10 +697,16 @@ function SDL.HMICapCache.clean()
   deleteFile(SDL.HMICapCache.file())
 end
 
---- A global function for organizing execution delays (using the OS)
--- @tparam number n The delay in ms
+--- A global function for organizing execution delays
+-- Qt event loop keeps running during the delay if the caller is a coroutine started by async()
+-- (e.g. a test step), otherwise ATF is blocked
+-- @tparam number n The delay in seconds
 function sleep(n)
-  os.execute("sleep " .. tonumber(n))
+  if timers.isAsync() then
+    timers.sleepAsync(tonumber(n) * 1000)
+  else
+    process.sleep(tonumber(n))
+  end
 end
 
 --- Launch SDL from ATF
@@ -665,7 +752,7 @@ function SDL:StartSDL(pathToSDL, smartDeviceLinkCore, ExitOnCrash, isAppInfoUpda
   if config.remoteConnection.enabled then
      result = ATF.remoteUtils.app:StartApp(pathToSDL, smartDeviceLinkCore)
   else
-     result = os.execute('./tools/StartSDL.sh ' .. pathToSDL .. ' ' .. smartDeviceLinkCore)
+     result = startLocalSDL(pathToSDL, smartDeviceLinkCore)
   end
 
   local msg
@@ -692,7 +779,7 @@ function SDL:StopSDL()
     if config.remoteConnection.enabled then
       ATF.remoteUtils.app:StopApp(config.SDL)
     else
-      os.execute('./tools/StopSDL.sh')
+      stopLocalSDL()
     end
   else
     local msg = "SDL had already stopped"
@@ -702,17 +789,19 @@ function SDL:StopSDL()
   if config.storeFullSDLLogs == true then
     sdl_logger.close()
   end
-  sleep(1)
+  if config.remoteConnection.enabled then
+    sleep(1)
+  end
   SDL:DeleteFile()
 end
 
 function SDL.ForceStopSDL()
   if config.remoteConnection.enabled then
     ATF.remoteUtils.app:StopApp(config.SDL)
+    sleep(1)
   else
-    os.execute("ps aux | grep ./" .. config.SDL .. " | awk '{print $2}' | xargs kill -9")
+    killLocalSDL()
   end
-  sleep(1)
 end
 
 function SDL.WaitForSDLStart(test)
@@ -721,26 +810,33 @@ function SDL.WaitForSDLStart(test)
   local step = 100
   local event = events.Event()
   event.matches = function(e1, e2) return e1 == e2 end
-  local function raise_event()
-    local output
-    if config.remoteConnection.enabled then
+  local ret = expectations.Expectation("Wait for SDL start", test.mobileConnection)
+  if config.remoteConnection.enabled then
+    local function raise_event()
       local res, state = ATF.remoteUtils.app:CheckAppStatus(config.SDL)
       if not res then
         error("RemoteUtils.app unable to get status of application: " .. config.SDL)
       end
-      output = (state == remote_constants.APPLICATION_STATUS.RUNNING)
-    else
-      local hmiPort = config.hmiAdapterConfig.WebSocket.port
-      output = os.execute("netstat -vatn  | grep " .. hmiPort .. " | grep LISTEN")
+      if state == remote_constants.APPLICATION_STATUS.RUNNING then
+        RAISE_EVENT(event, event)
+      else
+        RUN_AFTER(raise_event, step)
+      end
     end
-    if output then
+    RUN_AFTER(raise_event, step)
+  else
+    -- SDL is considered as started once HMI WebSocket port listens
+    local probe = network.ListenProbe()
+    local receiver = qt.dynamic()
+    function receiver.ready()
       RAISE_EVENT(event, event)
-    else
-      RUN_AFTER(raise_event, step)
     end
+    qt.connect(probe, "ready()", receiver, "ready()")
+    probe:start(config.hmiAdapterConfig.WebSocket.port)
+    -- Keep the probe alive while the expectation exists
+    ret.probe = probe
+    ret.probeReceiver = receiver
   end
-  RUN_AFTER(raise_event, step)
-  local ret = expectations.Expectation("Wait for SDL start", test.mobileConnection)
   ret.event = event
   event_dispatcher:AddEvent(test.mobileConnection, ret.event, ret)
   test:AddExpectation(ret)
@@ -772,23 +868,21 @@ function SDL:CheckStatusSDL()
     end
     error("Remote utils: unable to get Appstatus of SDL")
   else
-    local testFile = os.execute('test -e sdl.pid')
-    if testFile then
-      local testCatFile = os.execute('test -e /proc/$(cat sdl.pid)')
-      if not testCatFile then
-        return self.CRASH
-      end
+    if not isFileExist(pidFile) then
+      return self.STOPPED
+    end
+    local sdl = getLocalSDLProcess()
+    if sdl and sdl:running() then
       return self.RUNNING
     end
-    return self.STOPPED
+    return self.CRASH
   end
 end
 
 --- Deleting an SDL process indicator file
 function SDL.DeleteFile()
-  if os.execute('test -e sdl.pid') then
-    os.execute('rm -f sdl.pid')
-  end
+  os.remove(pidFile)
+  sdlProcess = nil
 end
 
 updateSdlPaths()
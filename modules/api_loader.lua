@@ -2,9 +2,12 @@
 --
 -- Use `load_schema` for loading Mobile and HMI API validation schema.
 --
--- *Dependencies:* `xml`
+-- Loaded tables are cached in binary file next to API xml file (see `api_schema.store_cache`),
+-- so each xml file content is parsed only once.
 --
--- *Globals:* `param_name`, `param_data`, `name`
+-- *Dependencies:* `xml`, `api_schema`
+--
+-- *Globals:* `param_name`, `param_data`, `name`, `api_schema`
 -- @module api_loader
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/)
 -- and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
@@ -168,12 +171,17 @@ end
 
 --- Parse api file to lua table.
 -- Each function, enum and struct will be
--- kept inside appropriate interface
+-- kept inside appropriate interface.
+-- Tables loaded from cache do not keep xml nodes of interfaces (`body`)
 -- @tparam string path Path to the xml file
 -- @tparam string include_parent_name Parent name
 -- @treturn table lua table with all xml RPCs
 function apiLoader.init(path, include_parent_name)
   apiLoader.include_parent_name = include_parent_name
+  local cache_path = path .. ".cache"
+  local cached = api_schema.load_cache(path, cache_path)
+  if cached then return cached end
+
   local result = {}
   result.interface = { }
 
@@ -185,6 +193,7 @@ function apiLoader.init(path, include_parent_name)
   LoadStructs(_api, result)
 
   LoadFunction(_api, result)
+  api_schema.store_cache(path, cache_path, result)
   return result
 end
 
@@ -1,8 +1,11 @@
 --- Module which is responsible for creating ATF log during test script run
 --
--- *Dependencies:* `json`, `atf.stdlib.std.io`, `protocol_handler.ford_protocol_constants`
+-- Records are formatted and written to files by native `logsink` on a background thread,
+-- Lua side only passes raw fields of a record.
 --
--- *Globals:* `qdatetime`, `timestamp`, `config`
+-- *Dependencies:* `json`, `atf.stdlib.std.io`, `protocol_handler.ford_protocol_constants`, `function_names`
+--
+-- *Globals:* `qdatetime`, `timestamp`, `config`, `logsink`
 -- @module atf_logger
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -14,33 +17,23 @@ local ford_constants = require("protocol_handler/ford_protocol_constants")
 --- Singleton table which is used for perform all logging activities for ATF log.
 -- @table Logger
 -- @tfield boolean is_open Describe status of ATF log file
--- @tfield string full_atf_log_file Name of full ATF log file
 -- @tfield string script_file_name Name of current script
--- @tfield string atf_log_file Name of normal ATF log file
+-- @tfield userdata sink Native log sink writing normal and full ATF log files
 -- @tfield number timestamp Current date + time (timestamp)
--- @tfield string mobile_log_format Format template for mobile communication log record
--- @tfield string hmi_log_format Format template for HMI communication log record
 -- @tfield number start_file_timestamp Date + time (timestamp) of start to write log file
 local Logger =
 {
   is_open = true,
-  full_atf_log_file = '',
   script_file_name = '',
-  atf_log_file = '',
+  sink = nil,
   timestamp = 0,
-  mobile_log_format = '',
-  hmi_log_format = '',
   start_file_timestamp = 0,
   mt = {
     __index = {}
   }
 }
 
-Logger.mobile_log_format = "%s [%s] [%s, sessionId: %s, version: %s, frameType: %s, "
-      .. "encryption: %s, serviceType: %s, frameInfo: %s, messageId: %s, binaryDataSize: %s] : %s \n\n"
-Logger.hmi_log_format = "%s [%s] %s \n"
-
-local rpc_function_id
+local rpc_function_names
 local ctrl_msg_map = (function()
     local out = {}
     for key, value in pairs(ford_constants.FRAME_INFO) do
@@ -72,10 +65,9 @@ local function get_function_name(message)
     return "controlMsg: " .. getControlFrameMessageName(message.frameInfo)
   end
 
-  for name, id in pairs(rpc_function_id) do
-    if id == message.rpcFunctionId then
-      return "rpcFunction: " .. name
-    end
+  local name = rpc_function_names[message.rpcFunctionId]
+  if name ~= nil then
+    return "rpcFunction: " .. name
   end
 
   return "nil"
@@ -95,19 +87,6 @@ function Logger.formated_time(without_date)
   return qdatetime.get_datetime("dd-MM-yyyy hh:mm:ss,zzz")
 end
 
---- Check message is it HMI tract
--- @treturn boolean Return true if tract is HMI tract
-local function is_hmi_tract(tract, message)
-  local str = string.format("%s", tract)
-  if string.find(str, "HMI")
-    or (message.frameType ~= ford_constants.FRAME_TYPE.CONTROL_FRAME)
-    and (message.serviceType ~= ford_constants.SERVICE_TYPE.PCM)
-    and (message.serviceType ~= ford_constants.SERVICE_TYPE.VIDEO) then
-    return true
-  end
-  return false
-end
-
 --- Calculate binary data size
 -- @tparam string binaryData Binary data of message
 -- @treturn number Binary data size
@@ -122,70 +101,53 @@ end
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from mobile application to SDL
 function Logger:MOBtoSDL(tract, message)
-  local log_str = string.format(Logger.mobile_log_format,"MOB->SDL", Logger.formated_time(),
-    get_function_name(message), message.sessionId, message.version, message.frameType,
-    message.encryption, message.serviceType, message.frameInfo, message.messageId, getBinaryDataSize(message.binaryData), message.payload)
-  if is_hmi_tract(tract, message) then
-    self.atf_log_file:write(log_str)
-  end
-  if config.storeFullATFLogs then
-    self.full_atf_log_file:write(log_str)
-  end
+  -- Log levels are checked before the message is formatted
+  local targets = self.sink:mobile_targets(tract, message.frameType, message.serviceType, message.frameInfo)
+  if targets == 0 then return end
+  self.sink:mobile(targets, "MOB->SDL", get_function_name(message), message.sessionId, message.version,
+    message.frameType, message.encryption, message.serviceType, message.frameInfo, message.messageId,
+    getBinaryDataSize(message.binaryData), message.payload)
 end
 
 --- Store auxiliary message about start of new test step for test scenario into ATF log file
 -- @tparam string test_case_name Test step name
 function Logger:StartTestCase(test_case_name)
-  self.atf_log_file:write(string.format("\n\n===== %s : \n", test_case_name))
-  if config.storeFullATFLogs then
-    self.full_atf_log_file:write(string.format("\n\n===== %s : \n", test_case_name))
-  end
+  self.sink:text(logsink.MAIN + logsink.FULL, string.format("\n\n===== %s : \n", test_case_name))
 end
 
 --- Store message from SDL to mobile application into ATF log file
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from SDL to mobile application
 function Logger:SDLtoMOB(tract, message)
+  -- Log levels are checked before the message is formatted
+  local targets = self.sink:mobile_targets(tract, message.frameType, message.serviceType, message.frameInfo)
+  if targets == 0 then return end
   local payload = message.payload
   if type(payload) == "table" then
     payload = json.encode(payload)
   end
 
-  local log_str = string.format(Logger.mobile_log_format,"SDL->MOB", Logger.formated_time(),
-    get_function_name(message), message.sessionId, message.version, message.frameType,
-    message.encryption, message.serviceType, message.frameInfo, message.messageId, getBinaryDataSize(message.binaryData), payload)
-  if is_hmi_tract(tract, message) then
-    self.atf_log_file:write(log_str)
-  end
-  if config.storeFullATFLogs then
-    self.full_atf_log_file:write(log_str)
-  end
+  self.sink:mobile(targets, "SDL->MOB", get_function_name(message), message.sessionId, message.version,
+    message.frameType, message.encryption, message.serviceType, message.frameInfo, message.messageId,
+    getBinaryDataSize(message.binaryData), payload)
 end
 
 --- Store message from HMI to SDL into ATF log file
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from HMI to SDL
 function Logger:HMItoSDL(tract, message)
-  local log_str = string.format(Logger.hmi_log_format, "HMI->SDL", Logger.formated_time(), message .. "\n")
-  if is_hmi_tract(tract, message) then
-    self.atf_log_file:write(log_str)
-  end
-  if config.storeFullATFLogs then
-    self.full_atf_log_file:write(log_str)
-  end
+  local targets = self.sink:hmi_targets(tract)
+  if targets == 0 then return end
+  self.sink:hmi(targets, "HMI->SDL", message, true)
 end
 
 --- Store message from SDL to HMI into ATF log file
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from SDL to HMI
 function Logger:SDLtoHMI(tract, message)
-  local log_str = string.format(Logger.hmi_log_format, "SDL->HMI", Logger.formated_time(), message)
-  if is_hmi_tract(tract, message) then
-    self.atf_log_file:write(log_str)
-  end
-  if config.storeFullATFLogs then
-    self.full_atf_log_file:write(log_str)
-  end
+  local targets = self.sink:hmi_targets(tract)
+  if targets == 0 then return end
+  self.sink:hmi(targets, "SDL->HMI", message)
 end
 
 --- Build script name on basis of script file name
@@ -216,26 +178,25 @@ end
 --- Initialization of ATF logger
 -- @tparam string script_name Test script name
 function Logger.init_log(script_name)
-  rpc_function_id = require('function_id')
+  rpc_function_names = require('function_names')
   Logger.script_file_name = script_name
   Logger.start_file_timestamp = timestamp()
 
   local timestamp = tostring(os.date('%Y%m%d%H%M%S', os.time()))
   local log_file_name = get_log_file_name(timestamp, "ATFLogs")
   local atf_log_file_name = log_file_name ..".txt"
-  Logger.atf_log_file = io.open(atf_log_file_name, "r")
-  if Logger.atf_log_file ~= nil then
-    io.close(Logger.atf_log_file)
-  end
-  Logger.atf_log_file = io.open(atf_log_file_name, "w+")
-
+  local full_atf_log_file_name
+  local full_atf_log_format = config.fullATFLogsFormat or "text"
   if config.storeFullATFLogs then
-    local full_atf_log_file_name = log_file_name .. "_full.txt";
-    Logger.full_atf_log_file = io.open(full_atf_log_file_name, "r")
-    if Logger.full_atf_log_file ~= nil then
-      io.close(Logger.full_atf_log_file)
+    if full_atf_log_format == "trace" then
+      full_atf_log_file_name = log_file_name .. "_full.atftrace"
+    else
+      full_atf_log_file_name = log_file_name .. "_full.txt"
     end
-    Logger.full_atf_log_file = io.open(full_atf_log_file_name, "w+")
+  end
+  Logger.sink = logsink.open(atf_log_file_name, full_atf_log_file_name, full_atf_log_format)
+  if config.ATFLogLevels then
+    Logger.sink:set_levels(config.ATFLogLevels)
   end
 
   setmetatable(Logger, Logger.mt)
@@ -259,10 +220,8 @@ end
 --- Store auxiliary message about finish of test scenario into ATF log file
 -- @tparam number count Test scenario executing time in seconds
 function Logger.LOGTestFinish(count)
-  Logger.atf_log_file:write(string.format("\n\n===== Total executing time is %s =====\n", count))
-  if config.storeFullATFLogs then
-    Logger.full_atf_log_file:write(string.format("\n\n===== Total executing time is %s =====\n", count))
-  end
+  Logger.sink:text(logsink.MAIN + logsink.FULL, string.format("\n\n===== Total executing time is %s =====\n", count))
+  Logger.sink:flush()
 end
 
 return Logger
@@ -69,6 +69,23 @@ config.ValidateSchema = true
 config.excludeReport = true
 --- Flag which defines whether ATF creates full ATF logs (with json files and service messages)
 config.storeFullATFLogs = true
+--- Define format of full ATF logs: "text" or "trace" (compact binary trace,
+-- rendered to text by atf_trace tool)
+config.fullATFLogsFormat = "text"
+--- Define ATF log levels per tract: "full" - normal and full ATF logs, "normal" - normal ATF log only,
+-- "none" - message is not logged. Level of mobile message is the lowest of its tract, service type
+-- and heartbeat levels. Levels are checked before message is formatted
+config.ATFLogLevels = {
+  MOBtoSDL = "full",
+  SDLtoMOB = "full",
+  HMItoSDL = "full",
+  SDLtoHMI = "full",
+  heartbeat = "full",
+  services = {
+    -- [0x0A] = "none", -- PCM
+    -- [0x0B] = "none"  -- VIDEO
+  }
+}
 --- Flag which defines whether ATF stores full SDLCore logs
 config.storeFullSDLLogs = false
 --- Define path to collected ATF and SDL logs
@@ -62,6 +62,7 @@ Test.timers = { }
 function Test.hmiConnection:EXPECT_HMIRESPONSE(id, args)
   local event = events.Event()
   event.matches = function(self, data) return data.id == id end
+  event:IndexBy("id", id)
   local ret = Expectation("HMI response " .. id, self)
   ret:ValidIf(function(self, data)
       local arguments
@@ -166,6 +167,7 @@ function Test:runSDL()
   end
   local result, errmsg = SDL:StartSDL(config.pathToSDL, config.SDL, config.ExitOnCrash)
   if not result then
+    xmlReporter.flush()
     quit(exit_codes.aborted)
   end
   SDL.autoStarted = true
@@ -234,6 +236,7 @@ function Test:initHMI_onReady()
     local event = events.Event()
     event.level = 1
     event.matches = function(self, data) return data.method == name end
+    event:IndexBy("method", name)
     return
     EXPECT_HMIEVENT(event, name)
     :Times(mandatory and 1 or AnyNumber())
@@ -253,6 +256,7 @@ function Test:initHMI_onReady()
     local event = events.Event()
     event.level = 1
     event.matches = function(self, data) return data.method == name end
+    event:IndexBy("method", name)
     return
     EXPECT_HMIEVENT(event, name)
     :Times(mandatory and 1 or AnyNumber())
@@ -527,6 +531,7 @@ function Test:connectMobile()
   :Times(AnyNumber())
   :Do(function()
       print("Disconnected!!!")
+      xmlReporter.flush()
       quit(exit_codes.aborted)
     end)
     local ret = EXPECT_EVENT(events.connectedEvent, "Connected")
@@ -571,6 +576,7 @@ function EXPECT_HMINOTIFICATION(name,...)
   local args = table.pack(...)
   local event = events.Event()
   event.matches = function(self, data) return data.method == name end
+  event:IndexBy("method", name)
   local ret = Expectation("HMI notification " .. name, Test.hmiConnection)
   if #args > 0 then
     ret:ValidIf(function(self, data)
@@ -605,6 +611,7 @@ function EXPECT_HMICALL(methodName, ...)
   local event = events.Event()
   event.matches =
   function(self, data) return data.method == methodName end
+  event:IndexBy("method", methodName)
   local ret = Expectation("HMI call " .. methodName, Test.hmiConnection)
   if #args > 0 then
     ret:ValidIf(function(self, data)
@@ -662,6 +669,7 @@ function EXPECT_ANY_SESSION_NOTIFICATION(funcName, ...)
   event.matches = function(_, data)
     return data.rpcFunctionId == functionId[funcName]
   end
+  event:IndexBy("rpcFunctionId", functionId[funcName])
   local ret = Expectation(funcName .. " notification", Test.mobileConnection)
   if #args > 0 then
     ret:ValidIf(function(self, data)
@@ -718,6 +726,7 @@ function EXPECT_ANY_SESSION_RESPONSE(correlationId, ...)
   event.matches = function(_, data)
     return data.rpcCorrelationId == correlationId
   end
+  event:IndexBy("rpcCorrelationId", correlationId)
   local ret = Expectation("response to " .. correlationId, Test.mobileConnection)
   if #args > 0 then
     ret:ValidIf(function(self, data)
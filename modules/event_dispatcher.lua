@@ -2,7 +2,7 @@
 --
 -- *Dependencies:* `expectations`, `events`
 --
--- *Globals:* `config`
+-- *Globals:* `config`, `timestamp()`
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
 
@@ -14,6 +14,51 @@ local events = require('events')
 local Dispatcher = {}
 local mt = { __index = { } }
 
+--- Remove event from index of events pool
+-- @tparam table index Index of events pool
+-- @tparam Event event Event to be removed
+local function indexRemove(index, event)
+  index.others[event] = nil
+  local key = index.keys[event]
+  if not key then return end
+  index.keys[event] = nil
+  local byValue = index.fields[key.field]
+  for i = 1, key.values.n do
+    local bucket = byValue[key.values[i]]
+    if bucket then
+      bucket[event] = nil
+      if next(bucket) == nil then byValue[key.values[i]] = nil end
+    end
+  end
+  if next(byValue) == nil then index.fields[key.field] = nil end
+end
+
+--- Add event to index of events pool
+-- @tparam table index Index of events pool
+-- @tparam Event event Event to be added
+local function indexAdd(index, event)
+  indexRemove(index, event)
+  if not event.indexField then
+    index.others[event] = true
+    return
+  end
+  local key = { field = event.indexField, values = event.indexValues }
+  index.keys[event] = key
+  local byValue = index.fields[key.field]
+  if not byValue then
+    byValue = { }
+    index.fields[key.field] = byValue
+  end
+  for i = 1, key.values.n do
+    local bucket = byValue[key.values[i]]
+    if not bucket then
+      bucket = { }
+      byValue[key.values[i]] = bucket
+    end
+    bucket[event] = true
+  end
+end
+
 --- Construct instance of EventDispatcher type
 -- @treturn EventDispatcher Constructed instance
 function Dispatcher.EventDispatcher()
@@ -30,12 +75,34 @@ function Dispatcher.EventDispatcher()
     --- Pre event handler
     preEventHandler = nil,
     --- Post event handler
-    postEventHandler = nil
+    postEventHandler = nil,
+    --- Indices of events pools of every connection
+    _indices = setmetatable({ }, { __mode = "k" }),
+    --- Expectations which have to be validated on next validation
+    _dirty = { },
+    --- Expectations without status which may expire by timeout
+    _pending = { },
+    --- The earliest time when one of pending expectations expires
+    _deadline = math.huge
   }
   setmetatable(res, mt)
   return res
 end
 
+--- Get index of events pool
+-- Index splits events by value of field declared with Event:IndexBy,
+-- events without such declaration are kept in 'others' set
+-- @tparam table pool Events pool of connection
+-- @treturn table Index of pool
+function mt.__index:GetIndex(pool)
+  local index = self._indices[pool]
+  if not index then
+    index = { fields = { }, keys = { }, others = { } }
+    self._indices[pool] = index
+  end
+  return index
+end
+
 --- Get Handler
 -- @tparam Connection conn Mobile/HMI connection
 -- @tparam Event event Event
@@ -54,10 +121,23 @@ end
 -- @treturn Expectation Handler
 function mt.__index:FindHandler(connection, data)
   -- Visit all event pools and find matching event
+  -- Only events indexed by values of data fields and non-indexed events are checked
   local function findInPool(pool, data)
-    for event, handler in pairs(pool) do
+    local index = self:GetIndex(pool)
+    for field, byValue in pairs(index.fields) do
+      local value = data[field]
+      local bucket = value ~= nil and byValue[value]
+      if bucket then
+        for event in pairs(bucket) do
+          if event:matches(data) then
+            return pool[event]
+          end
+        end
+      end
+    end
+    for event in pairs(index.others) do
       if event:matches(data) then
-        return handler
+        return pool[event]
       end
     end
     return nil
@@ -79,17 +159,34 @@ function mt.__index:OnPreEvent(func)
 end
 
 --- Set handler for post event
+-- Post event handler is called after expectations are validated: once per raised event
+-- and once per batch of data received at once, with the last data of the batch
 -- @tparam function func Post event handler.
 function mt.__index:OnPostEvent(func)
   self.postEventHandler = func
 end
 
+--- Validate expectation and track it till it gets status
+-- @tparam Expectation expectation Expectation to be validated
+function mt.__index:validateExpectation(expectation)
+  expectation:validate()
+  if expectation.status then
+    self._pending[expectation] = nil
+  else
+    self._pending[expectation] = true
+    self._deadline = math.min(self._deadline, expectation.ts + expectation.timeout)
+  end
+end
+
 --- Validate all expectations
 function mt.__index:validateAll()
+  self._dirty = { }
+  self._pending = { }
+  self._deadline = math.huge
 
   local function iter(pool)
     for _, expectation in pairs(pool) do
-      expectation:validate()
+      self:validateExpectation(expectation)
     end
   end
 
@@ -99,6 +196,24 @@ function mt.__index:validateAll()
   for _, pool in pairs(self._pool0) do iter(pool) end
 end
 
+--- Validate expectations which were added or occurred since last validation
+-- Pending expectations are revalidated only when the earliest of their timeouts expires
+function mt.__index:validateChanged()
+  local dirty = self._dirty
+  self._dirty = { }
+  for expectation in pairs(dirty) do
+    self:validateExpectation(expectation)
+  end
+  if timestamp() > self._deadline then
+    local pending = self._pending
+    self._pending = { }
+    self._deadline = math.huge
+    for expectation in pairs(pending) do
+      self:validateExpectation(expectation)
+    end
+  end
+end
+
 --- Subscribe on connection's [[OnInputData]] signal
 -- @tparam Connection connection Mobile/HMI connection
 function mt.__index:AddConnection(connection)
@@ -114,8 +229,9 @@ function mt.__index:AddConnection(connection)
       local exp = this:GetHandler(self, events.connectedEvent)
       if exp then
         exp.occurences = exp.occurences + 1
+        this._dirty[exp] = true
         exp:Action()
-        this:validateAll()
+        this:validateChanged()
       end
       if this.postEventHandler then
         this.postEventHandler(events.connectedEvent)
@@ -128,16 +244,47 @@ function mt.__index:AddConnection(connection)
       local exp = this:GetHandler(self, events.disconnectedEvent)
       if exp then
         exp.occurences = exp.occurences + 1
+        this._dirty[exp] = true
         exp:Action()
-        this:validateAll()
+        this:validateChanged()
       end
       if this.postEventHandler then
         this.postEventHandler(events.disconnectedEvent)
       end
     end)
-  connection:OnInputData(function (connection, data)
-      this:RaiseEvent(connection, data)
-    end)
+  if connection.OnInputBatch then
+    connection:OnInputBatch(function (connection, batch)
+        this:RaiseEvents(connection, batch)
+      end)
+  else
+    connection:OnInputData(function (connection, data)
+        this:RaiseEvent(connection, data)
+      end)
+  end
+end
+
+--- Pass data to expectation of matching event
+-- @tparam EventDispatcher self Event dispatcher
+-- @tparam Connection connection Mobile/HMI connection
+-- @tparam table data Data for rise event
+-- @treturn boolean True if data matched some event
+local function deliver(self, connection, data)
+  local exp = self:FindHandler(connection, data)
+  if not exp then return false end
+  exp.occurences = exp.occurences + 1
+  self._dirty[exp] = true
+  if data then
+    if exp.verifyData then
+      for _, verifyFunc in pairs(exp.verifyData) do
+          verifyFunc(exp, data)
+          if (config.checkAllValidations == false) and (exp.isAtLeastOneFail == true) then
+            break
+          end
+      end
+    end
+    exp:Action(data)
+  end
+  return true
 end
 
 --- Raise event
@@ -147,40 +294,57 @@ function mt.__index:RaiseEvent(connection, data)
   if self.preEventHandler and data then
     self.preEventHandler(data)
   end
-  local exp = self:FindHandler(connection, data)
-  if exp then
-    exp.occurences = exp.occurences + 1
-    if data then
-      if exp.verifyData then
-        for _, verifyFunc in pairs(exp.verifyData) do
-            verifyFunc(exp, data)
-            if (config.checkAllValidations == false) and (exp.isAtLeastOneFail == true) then
-              break
-            end
-        end
-      end
-      exp:Action(data)
-    end
-    self:validateAll()
+  if deliver(self, connection, data) then
+    self:validateChanged()
   end
   if self.postEventHandler then
     self.postEventHandler(data)
   end
 end
 
+--- Raise events for a batch of data received at once
+-- Pre event handler is called before each data is delivered; expectations are validated
+-- and post event handler is called once per batch, the latter gets the last data of the batch
+-- @tparam Connection connection Mobile/HMI connection
+-- @tparam table batch Array of data for rise events
+function mt.__index:RaiseEvents(connection, batch)
+  if #batch == 0 then return end
+  local matched = false
+  for _, data in ipairs(batch) do
+    if self.preEventHandler then
+      self.preEventHandler(data)
+    end
+    if deliver(self, connection, data) then
+      matched = true
+    end
+  end
+  if matched then
+    self:validateChanged()
+  end
+  if self.postEventHandler then
+    self.postEventHandler(batch[#batch])
+  end
+end
+
 --- Add event with expectation to pools
 -- @tparam Connection connection Mobile/HMI connection
 -- @tparam Event event Event to be addded
 -- @tparam Expectation expectation Expectation for added event
 function mt.__index:AddEvent(connection, event, expectation)
+  local pool
   if event.level == 3 then
-    self._pool3[connection][event] = expectation
+    pool = self._pool3[connection]
   elseif event.level == 2 then
-    self._pool2[connection][event] = expectation
+    pool = self._pool2[connection]
   elseif event.level == 1 then
-    self._pool1[connection][event] = expectation
+    pool = self._pool1[connection]
   elseif event.level == 0 then
-    self._pool0[connection][event] = expectation
+    pool = self._pool0[connection]
+  end
+  if pool then
+    pool[event] = expectation
+    indexAdd(self:GetIndex(pool), event)
+    self._dirty[expectation] = true
   end
 end
 
@@ -188,10 +352,16 @@ end
 -- @tparam Connection connection Mobile/HMI connection
 -- @tparam Event event Event to be removed
 function mt.__index:RemoveEvent(connection, event)
-  self._pool3[connection][event] = nil
-  self._pool2[connection][event] = nil
-  self._pool1[connection][event] = nil
-  self._pool0[connection][event] = nil
+  for _, pools in ipairs({ self._pool3, self._pool2, self._pool1, self._pool0 }) do
+    local pool = pools[connection]
+    local expectation = pool[event]
+    if expectation then
+      pool[event] = nil
+      indexRemove(self:GetIndex(pool), event)
+      self._dirty[expectation] = nil
+      self._pending[expectation] = nil
+    end
+  end
 end
 
 --- Remove all events with expectation from pools
@@ -200,6 +370,9 @@ function mt.__index:ClearEvents()
   for connection, _ in pairs(self._pool2) do self._pool2[connection] = { } end
   for connection, _ in pairs(self._pool1) do self._pool1[connection] = { } end
   for connection, _ in pairs(self._pool0) do self._pool0[connection] = { } end
+  self._dirty = { }
+  self._pending = { }
+  self._deadline = math.huge
 end
 
 return Dispatcher
@@ -40,4 +40,22 @@ end
 -- @treturn boolean True if event data matched to conditions
 function event_mt.__index:matches() return false end
 
+--- Declare that event matches only data which field has one of specified values
+-- Such events are looked up by the value of this field instead of calling matches for every event.
+-- Declaration does not replace matches function which still has to check the field.
+-- @tparam string field Name of field of event data
+-- @tparam any ... Values of field
+-- @treturn Event Event itself
+function event_mt.__index:IndexBy(field, ...)
+  local values = table.pack(...)
+  if values.n == 0 then return self end
+  for i = 1, values.n do
+    -- Event can't be indexed by nil value, so it stays in the list of non-indexed events
+    if values[i] == nil then return self end
+  end
+  self.indexField = field
+  self.indexValues = values
+  return self
+end
+
 return Events
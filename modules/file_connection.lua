@@ -74,6 +74,18 @@ function FileConnection.mt.__index:OnInputData(func)
   self.connection:OnInputData(func)
 end
 
+--- Set handler for OnInputBuffer
+-- Handler receives network.Buffer valid only during the call if lower level connection
+-- supports it, string otherwise
+-- @tparam function func Handler function
+function FileConnection.mt.__index:OnInputBuffer(func)
+  if self.connection.OnInputBuffer then
+    self.connection:OnInputBuffer(func)
+  else
+    self.connection:OnInputData(func)
+  end
+end
+
 --- Set handler for OnDataSent
 -- @tparam function func Handler function
 function FileConnection.mt.__index:OnDataSent(func)
@@ -0,0 +1,27 @@
+--- Module which is responsible for reverse lookup of mobile function names by function id
+--
+-- *Dependencies:* `function_id`
+--
+-- *Globals:* none
+-- @module function_names
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local functionId = require('function_id')
+
+--- Table with mobile function names, built once from `function_id`.
+-- Lookup by id is a single table access instead of iterating over all functions.
+--
+-- Record: <function_id> : <function_name>
+-- @table function_names
+local FunctionNames = { }
+
+for name, id in pairs(functionId) do
+  -- Keep the choice stable if several functions share an id
+  local known = FunctionNames[id]
+  if known == nil or name < known then
+    FunctionNames[id] = name
+  end
+end
+
+return FunctionNames
@@ -63,12 +63,16 @@ end
 function RemoteHMIAdapter.mt.__index:OnInputData(func)
   local d = self.qtproxy
   local this = self
+  -- The handler is replaced, the signal is connected only once
+  local connected = d.textMessageReceived ~= nil
   function d:textMessageReceived(text)
     atf_logger.LOG("SDLtoHMI", text)
     local data = json.decode(text)
     func(this, data)
   end
-  qt.connect(self.connection, "textMessageReceived(QString)", d, "textMessageReceived(QString)")
+  if not connected then
+    qt.connect(self.connection, "textMessageReceived(QString)", d, "textMessageReceived(QString)")
+  end
 end
 
 --- Set handler for OnDataSent
@@ -76,10 +80,13 @@ end
 function RemoteHMIAdapter.mt.__index:OnDataSent(func)
   local d = self.qtproxy
   local this = self
+  local connected = d.bytesWritten ~= nil
   function d:bytesWritten(num)
     func(this, num)
   end
-  qt.connect(self.connection, "bytesWritten(qint64)", d, "bytesWritten(qint64)")
+  if not connected then
+    qt.connect(self.connection, "bytesWritten(qint64)", d, "bytesWritten(qint64)")
+  end
 end
 
 --- Set handler for OnConnected
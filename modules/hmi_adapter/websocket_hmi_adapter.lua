@@ -33,8 +33,9 @@ function WS.Connection(params)
 end
 
 --- Connect with SDL
+-- Connection is established asynchronously, OnConnected handler is called once it is done
 function WS.mt.__index:Connect()
-  self.socket:open(self.url, self.port, config.connectionTimeout)
+  self.socket:open_async(self.url, self.port, config.connectionTimeout)
 end
 
 --- Check 'self' argument
@@ -62,26 +63,40 @@ end
 --- Set handler for OnInputData
 -- @tparam function func Handler function
 function WS.mt.__index:OnInputData(func)
-  local d = qt.dynamic()
-  local this = self
-  function d:textMessageReceived(text)
-    atf_logger.LOG("SDLtoHMI", text)
-    local data = json.decode(text)
-    --print("ws input:", text)
-    func(this, data)
+  if not self.qtproxy.textMessageReceived then
+    -- One slot serves all handlers, so no proxy object is left per handler
+    local this = self
+    self.inputHandlers = { }
+    function self.qtproxy.textMessageReceived(_, text)
+      atf_logger.LOG("SDLtoHMI", text)
+      local data = json.decode(text)
+      --print("ws input:", text)
+      for _, f in ipairs(this.inputHandlers) do
+        f(this, data)
+      end
+    end
+    -- Socket signals are handled directly, with no extra event loop hop per message
+    qt.connect(self.socket, "textMessageReceived(QString)", self.qtproxy, "textMessageReceived(QString)",
+      qt.DirectConnection)
   end
-  qt.connect(self.socket, "textMessageReceived(QString)", d, "textMessageReceived(QString)")
+  table.insert(self.inputHandlers, func)
 end
 
 --- Set handler for OnDataSent
 -- @tparam function func Handler function
 function WS.mt.__index:OnDataSent(func)
-  local d = qt.dynamic()
-  local this = self
-  function d:bytesWritten(num)
-    func(this, num)
+  if not self.qtproxy.bytesWritten then
+    local this = self
+    self.dataSentHandlers = { }
+    function self.qtproxy.bytesWritten(_, num)
+      for _, f in ipairs(this.dataSentHandlers) do
+        f(this, num)
+      end
+    end
+    qt.connect(self.socket, "bytesWritten(qint64)", self.qtproxy, "bytesWritten(qint64)",
+      qt.DirectConnection)
   end
-  qt.connect(self.socket, "bytesWritten(qint64)", d, "bytesWritten(qint64)")
+  table.insert(self.dataSentHandlers, func)
 end
 
 --- Set handler for OnConnected
@@ -1,12 +1,14 @@
---- Proxy module which is responsible for handling JSON
---
--- For additional information about current module functionality look at modules described in dependencies section.
---
--- *Dependencies:* `json4lua.json.json`
---
--- *Globals:* none
--- @module json
--- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
--- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
-
-return require("json4lua.json.json")
+--- Proxy module which is responsible for handling JSON
+--
+-- Allows loading of the native JSON codec by path (e.g. `require("modules/json")`).
+--
+-- For additional information about current module functionality look at modules described in dependencies section.
+--
+-- *Dependencies:* `json` (native module)
+--
+-- *Globals:* none
+-- @module json
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+return require("json")
@@ -150,7 +150,7 @@ function fstream_mt.__index:GetMessage()
       messageId = self.messageId
     }
 
-    res = table.concat(self.protocol_handler:Compose(header))
+    res = self.protocol_handler:ComposeBinary(header)
   end
   return res, nil
 end
@@ -179,11 +179,9 @@ function MD.MessageDispatcher(connection)
 
   function res.sender:SignalMessageSent() end
 
-  -- Prepare binary message for send it by tcp
-  -- c count of bytes
-  function res._d:bytesWritten(c)
-    if #res.generators == 0 then return end
-    res.bufferSize = res.bufferSize + c
+  -- Send next message of generators in round robin order
+  -- fits is a predicate which decides if the message can be sent right now
+  local function sendNext(fits)
     for _ = 1, #res.generators do
       if res.idx < #res.generators then
         res.idx = res.idx + 1
@@ -192,10 +190,9 @@ function MD.MessageDispatcher(connection)
       end
       local msg, timeout = res.generators[res.idx]:GetMessage()
       if msg and #msg > 0 then
-        if res.bufferSize >= #msg then
-          res.bufferSize = res.bufferSize - #msg
+        if fits(msg) then
           res.connection:Send({ msg })
-          break
+          return true
         else
           res.generators[res.idx]:KeepMessage(msg)
         end
@@ -203,6 +200,30 @@ function MD.MessageDispatcher(connection)
         res.timer:start(timeout)
       end
     end
+    return false
+  end
+
+  local function always() return true end
+
+  local function fitsBuffer(msg)
+    if res.bufferSize >= #msg then
+      res.bufferSize = res.bufferSize - #msg
+      return true
+    end
+    return false
+  end
+
+  -- Prepare binary message for send it by tcp
+  -- c count of bytes
+  function res._d:bytesWritten(c)
+    if #res.generators == 0 then return end
+    if res.connection.IsWritable then
+      -- Connection with a native send queue paces by real backpressure
+      while res.connection:IsWritable() and sendNext(always) do end
+      return
+    end
+    res.bufferSize = res.bufferSize + c
+    sendNext(fitsBuffer)
   end
 
   res.timer:setSingleShot(true)
@@ -215,13 +236,18 @@ end
 --- Set handler for OnMessageSent
 -- @tparam function func Handler function
 function MD.mt.__index:OnMessageSent(func)
-  local d = qt.dynamic()
-
-  function d:SlotMessageSent(v)
-    func(v)
+  if not self._d.SlotMessageSent then
+    -- One slot serves all handlers, so no proxy object is left per handler
+    local handlers = { }
+    self.messageSentHandlers = handlers
+    function self._d:SlotMessageSent(v)
+      for _, f in ipairs(handlers) do
+        f(v)
+      end
+    end
+    qt.connect(self.sender, "SignalMessageSent(int)", self._d, "SlotMessageSent(int)")
   end
-
-  qt.connect(self.sender, "SignalMessageSent(int)", d, "SlotMessageSent(int)")
+  table.insert(self.messageSentHandlers, func)
 end
 
 --- Add filebuffer to generators
@@ -24,19 +24,31 @@ function Tcp.Connection(params)
     sourceHost = params.source
   }
   res.socket = network.TcpClient()
+  -- Outgoing data is paced by the amount of data not yet taken by the kernel
+  res.sendQueue = res.socket:send_queue()
   setmetatable(res, Tcp.mt)
   res.qtproxy = qt.dynamic()
-
-  function res:inputData() end
+  -- Incoming data is read into the same buffer which is passed to buffer handlers as is
+  res.buffer = network.Buffer()
+  res.inputHandlers = { }
+  res.bufferHandlers = { }
 
   function res.qtproxy.readyRead()
-    while true do
-      local data = res.socket:read(81920)
-      if data == '' then break end
-      res.qtproxy:inputData(data)
+    while res.socket:read_into(res.buffer, 81920) > 0 do
+      for _, func in ipairs(res.bufferHandlers) do
+        func(res, res.buffer)
+      end
+      if #res.inputHandlers > 0 then
+        local data = res.buffer:tostring()
+        for _, func in ipairs(res.inputHandlers) do
+          func(res, data)
+        end
+      end
+      res.buffer:clear()
     end
   end
-  qt.connect(res.socket, "readyRead()", res.qtproxy, "readyRead()")
+  -- Socket signals are handled directly, with no extra event loop hop per message
+  qt.connect(res.socket, "readyRead()", res.qtproxy, "readyRead()", qt.DirectConnection)
 
   return res
 end
@@ -50,10 +62,11 @@ local function checkSelfArg(s)
 end
 
 --- Connect with SDL through QT transport interface
+-- Connection is established asynchronously, OnConnected handler is called once it is done
 function Tcp.mt.__index:Connect()
   xmlReporter.AddMessage("tcp_connection","Connect")
   checkSelfArg(self)
-  self.socket:connect(self.targetHost, self.targetPort, config.connectionTimeout, self.sourceHost)
+  self.socket:connect_async(self.targetHost, self.targetPort, config.connectionTimeout, self.sourceHost)
 end
 
 --- Send pack of messages from mobile to SDL
@@ -61,32 +74,57 @@ end
 function Tcp.mt.__index:Send(data)
   -- xmlReporter.AddMessage("tcp_connection","Send", data)
   checkSelfArg(self)
-  for _, c in ipairs(data) do
-    self.socket:write(c)
-  end
+  return self.sendQueue:write_many(data)
+end
+
+--- Check whether more data may be sent without exceeding the send queue high watermark
+-- @treturn boolean True if the send queue is below its high watermark
+function Tcp.mt.__index:IsWritable()
+  return self.sendQueue:writable()
+end
+
+--- Get statistics of sent data
+-- @treturn number Bytes written but not yet taken by the kernel
+-- @treturn number Bytes taken by the kernel
+-- @treturn number Throughput in bytes per second
+function Tcp.mt.__index:SendStats()
+  local sent, throughput = self.sendQueue:stats()
+  return self.sendQueue:in_flight(), sent, throughput
 end
 
 --- Set handler for OnInputData
 -- @tparam function func Handler function
 function Tcp.mt.__index:OnInputData(func)
   checkSelfArg(self)
-  local d = qt.dynamic()
-  local this = self
-  function d:inputData(data)
-    func(this, data)
-  end
-  qt.connect(self.qtproxy, "inputData(QByteArray)", d, "inputData(QByteArray)")
+  table.insert(self.inputHandlers, func)
+end
+
+--- Set handler for OnInputBuffer
+-- Handler receives network.Buffer with incoming data which is valid only during the call,
+-- so no string is created per read
+-- @tparam function func Handler function
+function Tcp.mt.__index:OnInputBuffer(func)
+  checkSelfArg(self)
+  table.insert(self.bufferHandlers, func)
 end
 
 --- Set handler for OnDataSent
 -- @tparam function func Handler function
 function Tcp.mt.__index:OnDataSent(func)
-  local d = qt.dynamic()
-  local this = self
-  function d:bytesWritten(num)
-    func(this, num)
+  checkSelfArg(self)
+  if not self.qtproxy.bytesWritten then
+    -- One slot serves all handlers, so no proxy object is left per handler
+    local this = self
+    self.dataSentHandlers = { }
+    function self.qtproxy.bytesWritten(_, num)
+      for _, f in ipairs(this.dataSentHandlers) do
+        f(this, num)
+      end
+    end
+    qt.connect(self.socket, "bytesWritten(qint64)", self.qtproxy, "bytesWritten(qint64)",
+      qt.DirectConnection)
   end
-  qt.connect(self.socket, "bytesWritten(qint64)", d, "bytesWritten(qint64)")
+  table.insert(self.dataSentHandlers, func)
 end
 
 --- Set handler for OnConnected
@@ -59,6 +59,7 @@ local function checkSelfArg(s)
 end
 
 --- Connect to SDL through QT transport interface
+-- Connection is established asynchronously, OnConnected handler is called once it is done
 function WebEngineWS.mt.__index:Connect()
   xmlReporter.AddMessage("websocket_connection","Connect")
   checkSelfArg(self)
@@ -66,36 +67,41 @@ function WebEngineWS.mt.__index:Connect()
   --   print("SSL errors have occurred")
   -- end
   -- qt.connect(self.socket, "sslErrors(QList<QSslError>)", self.qtproxy, "onSslErrors(QList<QSslError>)")
-  self.socket:open(self.url, self.port, config.connectionTimeout, self.ssl)
+  self.socket:open_async(self.url, self.port, config.connectionTimeout, self.ssl)
 end
 
 --- Send pack of messages from mobile to SDL
 -- @tparam table data Data to be sent
 function WebEngineWS.mt.__index:Send(data)
   checkSelfArg(self)
-  for _, c in ipairs(data) do
-    self.socket:binary_write(c)
-  end
+  self.socket:write_many(data, true)
 end
 
 --- Set handler for OnInputData
 -- @tparam function func Handler function
 function WebEngineWS.mt.__index:OnInputData(func)
   local this = self
+  -- The handler is replaced, the signal is connected only once
+  local connected = self.qtproxy.binaryMessageReceived ~= nil
   function self.qtproxy:binaryMessageReceived(data)
     func(this, data)
   end
-  qt.connect(self.socket, "binaryMessageReceived(QByteArray)", self.qtproxy, "binaryMessageReceived(QByteArray)")
+  if not connected then
+    qt.connect(self.socket, "binaryMessageReceived(QByteArray)", self.qtproxy, "binaryMessageReceived(QByteArray)")
+  end
 end
 
 --- Set handler for OnDataSent
 -- @tparam function func Handler function
 function WebEngineWS.mt.__index:OnDataSent(func)
   local this = self
+  local connected = self.qtproxy.bytesWritten ~= nil
   function self.qtproxy:bytesWritten(num)
     func(this, num)
   end
-  qt.connect(self.socket, "bytesWritten(qint64)", self.qtproxy, "bytesWritten(qint64)")
+  if not connected then
+    qt.connect(self.socket, "bytesWritten(qint64)", self.qtproxy, "bytesWritten(qint64)")
+  end
 end
 
 --- Set handler for OnConnected
@@ -81,6 +81,7 @@ function MobileConnection.mt.__index:StartSecureSession(test, regAppParameters)
   startSecureSessionEvent.matches = function(_, data)
       return data.message == MATCH_MESSAGE
     end
+  startSecureSessionEvent:IndexBy("message", MATCH_MESSAGE)
 
   self:StartSession(test, regAppParameters)
   :Do(function(exp, _)
@@ -120,6 +121,16 @@ function MobileConnection.mt.__index:StopStreaming(filename)
   self.connection:StopStreaming(filename)
 end
 
+--- Subscribe on incoming data of lower level connection
+-- Handler receives network.Buffer if the connection supports it (data is parsed at once), string otherwise
+local function subscribeInput(connection, func)
+  if connection.OnInputBuffer then
+    connection:OnInputBuffer(func)
+  else
+    connection:OnInputData(func)
+  end
+end
+
 --- Set handler for OnInputData
 -- @tparam function messageHandlerFunc Handler function
 function MobileConnection.mt.__index:OnInputData(messageHandlerFunc)
@@ -139,7 +150,51 @@ function MobileConnection.mt.__index:OnInputData(messageHandlerFunc)
       messageHandlerFunc(self, msg)
     end
   end
-  self.connection:OnInputData(f)
+  subscribeInput(self.connection, f)
+end
+
+--- Set handler for OnInputBatch
+-- Handler receives all frames and messages parsed from one portion of input data at once,
+-- in the order they are received: every frame is followed by the message it completes
+-- @tparam function batchHandlerFunc Handler function
+function MobileConnection.mt.__index:OnInputBatch(batchHandlerFunc)
+  local protocol_handler = ph.ProtocolHandler()
+  local frames = { }
+  local origins = { }
+  local frameHandlerFunc =
+    function(frameMessage)
+      -- Parser keeps updating the message after the frame is handled, so a snapshot is queued
+      local frame = { }
+      for k, v in pairs(frameMessage) do frame[k] = v end
+      frame._technical = { }
+      for k, v in pairs(frameMessage._technical) do frame._technical[k] = v end
+      frame._technical.isFrame = true
+      table.insert(frames, frame)
+      table.insert(origins, frameMessage)
+    end
+  local f =
+  function(_, binary)
+    local msgs = protocol_handler:Parse(binary, nil, frameHandlerFunc)
+    if #frames == 0 then return end
+    local completed = { }
+    for _, msg in ipairs(msgs) do
+      completed[msg] = true
+    end
+    local batch = { }
+    for i, frame in ipairs(frames) do
+      table.insert(batch, frame)
+      local msg = origins[i]
+      if completed[msg] then
+        -- After refactoring should be moved in mobile session
+        atf_logger.LOG("SDLtoMOB", msg)
+        table.insert(batch, msg)
+      end
+    end
+    frames = { }
+    origins = { }
+    batchHandlerFunc(self, batch)
+  end
+  subscribeInput(self.connection, f)
 end
 
 --- Set handler for OnDataSent
@@ -335,6 +335,7 @@ function mt.__index:Start()
   startEvent.matches = function(_, data)
       return data.message == "StartEvent"
     end
+  startEvent:IndexBy("message", "StartEvent")
 
   self:StartRPC()
   :Do(function(exp, _)
@@ -2,7 +2,7 @@
 --
 -- *Dependencies:* `json`, `protocol_handler.ford_protocol_constants`, `bit32`, `security.security_manager`, `security.security_constants`
 --
--- *Globals:* `bit32`
+-- *Globals:* `bit32`, `protocol`
 -- @module protocol_handler.protocol_handler
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -13,7 +13,6 @@ local constants = require('protocol_handler/ford_protocol_constants')
 local securityManager = require('security/security_manager')
 local securityConstants = require('security/security_constants')
 local mt = { __index = { } }
-local LAST_FRAME = 0x00
 
 --- Type which represents protocol level message handling
 -- @type ProtocolHandler
@@ -23,9 +22,7 @@ local LAST_FRAME = 0x00
 function ProtocolHandler.ProtocolHandler()
   local ret =
   {
-    buffer = "",
-    frames = { },
-    totalSize = { }
+    parser = protocol.Parser()
   }
   setmetatable(ret, mt)
   return ret
@@ -102,29 +99,6 @@ local function createProtocolHeader(message)
   return res
 end
 
---- Build table representation of message header
--- @tparam string buffer Bytes to create protocol header table from
--- @treturn table Built table representation of message header
--- @see `Applink Protocol`
-local function parseProtocolHeader(buffer)
-    local size = bytesToInt32(buffer, 5)
-    if #buffer < size + constants.PROTOCOL_HEADER_SIZE then
-      return nil
-    end
-    local msg = {}
-    msg._technical = {}
-    local firstByte = string.byte(buffer, 1)
-    msg.version = bit32.rshift(bit32.band(firstByte, 0xf0), 4)
-    msg.frameType = bit32.band(firstByte, 0x07)
-    msg.encryption = bit32.band(firstByte, 0x08) == 0x08
-    msg.serviceType = string.byte(buffer, 2)
-    msg.frameInfo = string.byte(buffer, 3)
-    msg.sessionId = string.byte(buffer, 4)
-    msg.size = size
-    msg.messageId = bytesToInt32(buffer, 9)
-    return msg
-end
-
 --- Check whether binary data has binary header
 -- @tparam table msg Message with binary data
 -- @treturn boolean True if binary data of message has binary header
@@ -181,8 +155,10 @@ local function hasToBuildBinaryHeader(message)
 end
 
 --- Build table representation of binary data header
+--
+-- Payload is decoded on demand (see `json.lazy`)
 -- @tparam table message Bytes to create protocol header table from
--- @tparam boolean validateJson If true then JSON should be parsed
+-- @tparam boolean validateJson If true then JSON is not decoded, payload is left unset
 local function parseBinaryHeader(message, validateJson)
   local BINARY_HEADER_SIZE = 12
   local rpcType = bit32.rshift(string.byte(message.binaryData, 1), 4)
@@ -201,7 +177,8 @@ local function parseBinaryHeader(message, validateJson)
   message.rpcCorrelationId = uint32ToInt32(bytesToInt32(message.binaryData, 5))
   if message.rpcJsonSize > 0 then
     if not validateJson then
-      message.payload = json.decode(string.sub(message.binaryData, BINARY_HEADER_SIZE + 1, BINARY_HEADER_SIZE + message.rpcJsonSize))
+      message.payload = json.lazy(string.sub(message.binaryData, BINARY_HEADER_SIZE + 1,
+        BINARY_HEADER_SIZE + message.rpcJsonSize))
     end
   end
   if message.size > message.rpcJsonSize + BINARY_HEADER_SIZE then
@@ -267,19 +244,14 @@ local function getProtocolFrameSize(version)
 end
 
 --- Parse binary message from SDL to table with json validation
--- @tparam string binary Message to parse
--- @tparam boolean validateJson True if JSON validation is required
+-- @tparam string|userdata binary Message to parse, either string or network.Buffer
+-- @tparam boolean validateJson True if JSON validation is required, then payloads are not decoded,
+-- otherwise they are decoded lazily
 -- @tparam function frameHandler Function for additional handling for each incoming frame
 -- @treturn table Parsed message
 function mt.__index:Parse(binary, validateJson, frameHandler)
-  self.buffer = self.buffer .. binary
   local res = { }
-  while #self.buffer >= constants.PROTOCOL_HEADER_SIZE do
-    local msg = parseProtocolHeader(self.buffer)
-    if not msg then break end
-    msg.binaryData = string.sub(self.buffer, constants.PROTOCOL_HEADER_SIZE + 1, constants.PROTOCOL_HEADER_SIZE + msg.size)
-    self.buffer = string.sub(self.buffer, msg.size + constants.PROTOCOL_HEADER_SIZE + 1)
-
+  for _, msg in ipairs(self.parser:parse(binary)) do
     local decryptedData
     msg._technical.decryptionStatus, decryptedData = decryptPayload(msg.binaryData, msg)
     if msg._technical.decryptionStatus == securityConstants.SECURITY_STATUS.SUCCESS then
@@ -291,37 +263,50 @@ function mt.__index:Parse(binary, validateJson, frameHandler)
     if #msg.binaryData == 0
        or msg._technical.decryptionStatus == securityConstants.SECURITY_STATUS.ERROR then
       table.insert(res, msg)
-    else
-      local key = "s"..msg.sessionId.."m"..msg.messageId
-      if msg.frameType == constants.FRAME_TYPE.CONTROL_FRAME then
-        table.insert(res, msg)
-      elseif msg.frameType == constants.FRAME_TYPE.FIRST_FRAME then
-        self.frames[key] = ""
-        self.totalSize[key] = msg.size
-      elseif msg.frameType == constants.FRAME_TYPE.SINGLE_FRAME then
+    elseif msg.frameType == constants.FRAME_TYPE.CONTROL_FRAME then
+      table.insert(res, msg)
+    elseif msg.frameType == constants.FRAME_TYPE.SINGLE_FRAME then
+      if isBinaryDataHasHeader(msg) then
+        parseBinaryHeader(msg, validateJson)
+      end
+      table.insert(res, msg)
+    elseif msg.frameType == constants.FRAME_TYPE.FIRST_FRAME
+        or msg.frameType == constants.FRAME_TYPE.CONSECUTIVE_FRAME then
+      -- Multiframe messages are reassembled natively, the last frame receives whole data
+      if self.parser:assemble(msg) then
         if isBinaryDataHasHeader(msg) then
           parseBinaryHeader(msg, validateJson)
         end
         table.insert(res, msg)
-      elseif msg.frameType == constants.FRAME_TYPE.CONSECUTIVE_FRAME then
-        self.frames[key] = self.frames[key] .. msg.binaryData
-        self.totalSize[key] = self.totalSize[key] + msg.size
-        if msg.frameInfo == LAST_FRAME then
-          msg.binaryData = self.frames[key]
-          msg.size = self.totalSize[key]
-          self.frames[key] = nil
-          self.totalSize[key] = nil
-          if isBinaryDataHasHeader(msg) then
-            parseBinaryHeader(msg, validateJson)
-          end
-          table.insert(res, msg)
-        end
       end
     end
   end
   return res
 end
 
+--- Check whether message payload has to be encrypted on composing
+-- @tparam table message Message with header
+-- @treturn boolean True if payload of message is encrypted by security manager
+local function hasToEncryptPayload(message)
+  return message.encryption and not isStartService(message)
+end
+
+--- Compose frames of message not requiring encryption natively
+-- @tparam table message Table representation of message
+-- @tparam boolean contiguous True if frames have to be returned as one string
+-- @treturn table|string Table with binary frames or string with all frames
+local function composeFrames(message, contiguous)
+  local frameSize = getProtocolFrameSize(message.version)
+  local res = protocol.compose(message, frameSize, contiguous)
+  -- Payload of multiframe message is consumed by consecutive frames
+  if message.binaryData and #message.binaryData > frameSize - constants.PROTOCOL_HEADER_SIZE then
+    message.binaryData = ""
+  else
+    message.binaryData = message.binaryData or ""
+  end
+  return res
+end
+
 --- Build binary frame from message
 -- @tparam table message Version of SDL protocol
 -- @treturn string Binary frame
@@ -333,6 +318,9 @@ function mt.__index:GetBinaryFrame(message)
     if #message.binaryData > max_protocol_payload_size then
       error("Size of current frame is bigger than max frame size for protocol version " .. message.version)
     end
+    if not hasToEncryptPayload(message) then
+      return composeFrames(message, true)
+    end
     message.binaryData = encryptPayload(message.binaryData, message)
   else
     message.binaryData = ""
@@ -341,18 +329,15 @@ function mt.__index:GetBinaryFrame(message)
   return createProtocolHeader(message) .. message.binaryData
 end
 
---- Compose table with binary message and header for SDL
+--- Compose frames of message with encrypted payload
+-- @tparam ProtocolHandler self Instance of ProtocolHandler
 -- @tparam table message Table representation of message
 -- @treturn table Table with binary message and header
-function mt.__index:Compose(message)
+local function composeEncrypted(self, message)
   local kMax_protocol_payload_size = getProtocolFrameSize(message.version)
      - constants.PROTOCOL_HEADER_SIZE
   local res = {}
 
-  if hasToBuildBinaryHeader(message) then
-    message.binaryData = rpcPayload(message)
-  end
-
   local binaryDataSize = 0
   if message.binaryData then binaryDataSize = #message.binaryData end
 
@@ -402,4 +387,30 @@ function mt.__index:Compose(message)
   return res
 end
 
+--- Compose table with binary message and header for SDL
+-- @tparam table message Table representation of message
+-- @treturn table Table with binary message and header
+function mt.__index:Compose(message)
+  if hasToBuildBinaryHeader(message) then
+    message.binaryData = rpcPayload(message)
+  end
+  if hasToEncryptPayload(message) then
+    return composeEncrypted(self, message)
+  end
+  return composeFrames(message, false)
+end
+
+--- Compose binary message with all its frames for SDL
+-- @tparam table message Table representation of message
+-- @treturn string Binary frames of message written one after another
+function mt.__index:ComposeBinary(message)
+  if hasToBuildBinaryHeader(message) then
+    message.binaryData = rpcPayload(message)
+  end
+  if hasToEncryptPayload(message) then
+    return table.concat(composeEncrypted(self, message))
+  end
+  return composeFrames(message, true)
+end
+
 return ProtocolHandler
@@ -16,6 +16,8 @@ local io = require('atf.stdlib.std.io')
 -- @tfield string script_file_name Name of testing script file
 -- @tfield userdata ndoc XML builder
 -- @tfield userdata root Root node of XML report
+-- @tfield userdata stream Writer which appends finished test steps to the report file
+-- @tfield userdata streamed_node Finished test step which is written to the report file and still kept in memory
 -- @tfield string curr_report_name Current report name
 local Reporter = {
   timestamp = '',
@@ -23,6 +25,7 @@ local Reporter = {
   ndoc = {},
   curr_node = {},
   root = {},
+  stream = {},
   curr_report_name = {},
   mt = {_index = {}}
 }
@@ -58,12 +61,34 @@ local function dump(o)
   return tostring(o)
 end
 
+--- Write node to report file
+-- Finished test step is on disk already, it is replaced as messages might have been added after its end
+-- @tparam userdata node Node to write
+local function streamNode(node)
+  if node == Reporter.streamed_node then
+    Reporter.stream:rewrite(node)
+  else
+    Reporter.stream:write(node)
+  end
+end
+
+--- Append current test step to report file and release it
+-- Only the step being executed is kept in memory, finished steps are never serialized again
+local function flushCase()
+  for _, node in ipairs(Reporter.root:children()) do
+    streamNode(node)
+    node:remove()
+  end
+  Reporter.streamed_node = nil
+  Reporter.curr_node = Reporter.root
+end
+
 --- Add test step to report
 -- @tparam string name Test step name
 function Reporter.AddCase(name)
   if(not config.excludeReport) then
+    flushCase()
     Reporter.curr_node = Reporter.root:addChild(name)
-    Reporter.ndoc:write(Reporter.curr_report_name)
   end
 end
 
@@ -88,7 +113,6 @@ function Reporter.AddMessage(name,funcName,...)
     elseif(attrib ~= nil) then
       msg:text(attrib)
     end
-    Reporter.ndoc:write(Reporter.curr_report_name)
   end
 end
 
@@ -104,16 +128,30 @@ function Reporter.CaseMessageTotal(name, ... )
       end
       Reporter.curr_node:attr(attr_n, attr_v)
     end
+    -- The step is finished: write it to disk, so it is not lost on abort or crash.
+    -- It is kept in memory until the next step starts
+    if Reporter.curr_node ~= Reporter.root then
+      streamNode(Reporter.curr_node)
+      Reporter.streamed_node = Reporter.curr_node
+    end
+    Reporter.stream:flush()
   end
 end
 
---- Finalize report
-function Reporter.finalize()
+--- Write current test step and all pending output to report file
+-- Has to be called before ATF exits without finalizing the report
+function Reporter.flush()
   if(not config.excludeReport) then
-    Reporter.ndoc:write(Reporter.curr_report_name)
+    flushCase()
+    Reporter.stream:flush()
   end
 end
 
+--- Finalize report
+function Reporter.finalize()
+  Reporter.flush()
+end
+
 -- Build script name from path to its file
 -- @tparam string str Path to script file
 -- @treturn string Script name
@@ -150,6 +188,8 @@ function Reporter.init(script_file_name)
   Reporter.ndoc = xml.new()
   local alias = report_header_name:gsub('%.', '_'):gsub('/','_')
   Reporter.root = Reporter.ndoc:createRootNode(alias)
+  Reporter.curr_node = Reporter.root
+  Reporter.stream = assert(xml.stream(Reporter.curr_report_name, alias))
   return Reporter
 end
 
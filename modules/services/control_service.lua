@@ -35,6 +35,7 @@ local function performStartServiceHandshake(controlService)
           and data.sessionId == controlService.session.sessionId.get()
           and data.rpcFunctionId == constants.BINARY_RPC_FUNCTION_ID.HANDSHAKE
       end
+    handshakeEvent:IndexBy("rpcFunctionId", constants.BINARY_RPC_FUNCTION_ID.HANDSHAKE)
 
     handShakeExp = controlService.session:ExpectEvent(handshakeEvent, "Handshake"):Times(AtLeast(1))
     :Do(function(_, data)
@@ -91,6 +92,8 @@ local function baseStartService(controlService, service, isSecure)
       or data.frameInfo == constants.FRAME_INFO.START_SERVICE_NACK)
     and data.encryption == isSecure
   end
+  startServiceEvent:IndexBy("frameInfo", constants.FRAME_INFO.START_SERVICE_ACK,
+    constants.FRAME_INFO.START_SERVICE_NACK)
 
   local ret = controlService.session:ExpectEvent(startServiceEvent, "StartService ACK")
   ret:ValidIf(function(_, data)
@@ -179,6 +182,7 @@ function mt.__index:StopService(service)
     (data.frameInfo == constants.FRAME_INFO.END_SERVICE_ACK or
       data.frameInfo == constants.FRAME_INFO.END_SERVICE_NACK)
   end
+  event:IndexBy("frameInfo", constants.FRAME_INFO.END_SERVICE_ACK, constants.FRAME_INFO.END_SERVICE_NACK)
 
   local ret = self.session:ExpectEvent(event, "EndService ACK")
   :ValidIf(function(_, data)
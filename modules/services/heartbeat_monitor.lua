@@ -42,6 +42,7 @@ local function ExpectHeartbeatAck(heartBeatMonitor)
     return data.sessionId == heartBeatMonitor.session.sessionId.get()
       and isHeartbeatAckMessage(data)
   end
+  event:IndexBy("frameInfo", constants.FRAME_INFO.HEARTBEAT_ACK)
   heartBeatMonitor.expectations:ExpectEvent(event, "HeartbeatACK")
   :Do(function(_, _)
       heartBeatMonitor.isHeartbeatConfirmedBySDL = true
@@ -68,6 +69,7 @@ local function AddHeartbeatExpectation(heartBeatMonitor)
     return data.sessionId == heartBeatMonitor.session.sessionId.get()
       and isHeartbeatMessage(data)
   end
+  event:IndexBy("frameInfo", constants.FRAME_INFO.HEARTBEAT)
   heartBeatMonitor.expectations:ExpectEvent(event, "Heartbeat")
   :Pin()
   :Times(AnyNumber())
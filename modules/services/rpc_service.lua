@@ -1,6 +1,6 @@
 --- Module which provides RPCService type
 --
--- *Dependencies:* `atf.util`, `function_id`, `json`, `protocol_handler.ford_protocol_constants`, `events`, `expectations`, `load_schema`
+-- *Dependencies:* `atf.util`, `function_id`, `function_names`, `json`, `protocol_handler.ford_protocol_constants`, `events`, `expectations`, `load_schema`
 --
 -- *Globals:* `xmlReporter`, `event_dispatcher`, `compareValues`
 -- @module services.rpc_service
@@ -10,6 +10,7 @@
 require('atf.util')
 
 local functionId = require('function_id')
+local functionNames = require('function_names')
 local json = require('json')
 local constants = require('protocol_handler/ford_protocol_constants')
 local securityConstants = require('security/security_constants')
@@ -45,6 +46,11 @@ local function baseExpectRequest(RPCService, funcName, ...)
       and data.sessionId == RPCService.session.sessionId.get()
       and data.rpcType == constants.BINARY_RPC_TYPE.REQUEST
   end
+  if type(funcName) == 'string' then
+    requestEvent:IndexBy("rpcFunctionId", functionId[funcName])
+  else
+    requestEvent:IndexBy("rpcFunctionId", funcName)
+  end
   local ret = RPCService.session:ExpectEvent(requestEvent, funcName .. " request")
   if #args > 0 then
     ret:ValidIf(function(exp, data)
@@ -111,12 +117,14 @@ local function baseExpectResponse(RPCService, cor_id, ...)
         end
         return false
       end
+    responseEvent:IndexBy("rpcCorrelationId", table.unpack(tbl_corr_id))
   else
     responseEvent.matches = function(_, data)
         return data.rpcCorrelationId == cor_id
           and data.sessionId == RPCService.session.sessionId.get()
           and data.rpcType == constants.BINARY_RPC_TYPE.RESPONSE
       end
+    responseEvent:IndexBy("rpcCorrelationId", cor_id)
   end
   local ret = RPCService.session:ExpectEvent(responseEvent, "Response to " .. cor_id)
   if #args > 0 then
@@ -152,6 +160,7 @@ local function baseExpectNotification(RPCService, funcName, ...)
       and data.sessionId == RPCService.session.sessionId.get()
       and data.rpcType == constants.BINARY_RPC_TYPE.NOTIFICATION
   end
+  notificationEvent:IndexBy("rpcFunctionId", functionId[funcName])
   local args = table.pack(...)
 
   if #args ~= 0 and (#args[1] > 0 or args[1].n == 0) then
@@ -211,15 +220,8 @@ function mt.__index:CheckCorrelationID(message)
     message_correlation_id = cor_id
   end
   if not self.session.cor_id_func_map[message_correlation_id] then
-    for fname, fid in pairs(functionId) do
-      if fid == message.rpcFunctionId then
-        self.session.cor_id_func_map[message_correlation_id] = fname
-        break
-      end
-    end
-    if not self.session.cor_id_func_map[message_correlation_id] then
-      self.session.cor_id_func_map[message_correlation_id] = message.rpcFunctionId
-    end
+    self.session.cor_id_func_map[message_correlation_id] =
+      functionNames[message.rpcFunctionId] or message.rpcFunctionId
   else
     print("RPC service Warning: Message with correlationId: " .. message_correlation_id
       .. " in session " .. self.session.sessionId.get() .. " was sent earlier by ATF")
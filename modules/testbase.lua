@@ -9,7 +9,7 @@
 -- *Dependencies:* `qt`, `event_dispatcher`, `events`, `expectations`, `console`, `format`, `SDL`, `exit_codes`, `config`
 --
 -- *Globals:* `xmlReporter`, `qt`, `critical()`, `description()`, `timestamp()`, `atf_logger`, `print_stopscript()`,
--- `is_redirected`, `config`, `event_dispatcher`, `quit`, `timeoutTimer`
+-- `is_redirected`, `config`, `event_dispatcher`, `quit`, `timeoutTimer`, `async()`
 -- @module testbase
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -138,11 +138,28 @@ local mt =
   __metatable = { }
 }
 
---- Runs next Test Case or quit ATF execution
+--- Run function of a test step in a coroutine, so the step is able to wait without blocking the event loop
+-- Status of the test step is not checked and the next test step is not started until the function returns
+-- @tparam function func Function to run
+-- @lfunction runStep
+local function runStep(func)
+  Test.isStepRunning = true
+  async(function()
+    local ok, err = pcall(func)
+    Test.isStepRunning = false
+    if Test.isNextCasePending then
+      Test.isNextCasePending = false
+      control:next()
+    end
+    if not ok then error(err, 0) end
+  end)
+end
+
+--- Starts next Test Case or quit ATF execution
 -- Test case is any testbase inheritor
 -- with a first capital letter
--- @lfunction control.runNextCase
-function control.runNextCase()
+-- @lfunction startNextCase
+local function startNextCase()
   Test.isStepCompleted = false
   Test.ts = timestamp()
   Test.current_case_time = atf_logger.formated_time(true)
@@ -166,6 +183,17 @@ function control.runNextCase()
   end
 end
 
+--- Runs next Test Case in a coroutine
+-- Postponed until the running test step function returns
+-- @lfunction control.runNextCase
+function control.runNextCase()
+  if Test.isStepRunning then
+    Test.isNextCasePending = true
+    return
+  end
+  runStep(startNextCase)
+end
+
 --- Support method for asynchronous start Tests execution
 -- @lfunction control.start
 function control:start()
@@ -179,6 +207,7 @@ end
 --- Checks Test Case result and SDL status
 --- In case of any critical issues - interrupts Test Suit execution
 local function CheckStatus()
+  if Test.isStepRunning then return end
   if Test.current_case_name == nil or Test.current_case_name == '' then return end
   -- Check the test status
   local success = true
@@ -231,15 +260,20 @@ local function CheckStatus()
     end
   end
   fmt.PrintCaseResult(Test.current_case_time, Test.current_case_name, success, errorMessage, warningMessage, timestamp() - Test.ts)
-  xmlReporter.CaseMessageTotal(Test.current_case_name,{ ["result"] = success, ["timestamp"] = (timestamp() - Test.ts)} )
   if (not success) then xmlReporter.AddMessage("ErrorMessage", {["Status"] = "FAILED"}, errorMessage ) end
+  xmlReporter.CaseMessageTotal(Test.current_case_name,{ ["result"] = success, ["timestamp"] = (timestamp() - Test.ts)} )
   Test.expectations_list:Clear()
   Test.current_case_name = nil
   if Test.current_case_mandatory and not success then
-    SDL:StopSDL()
-    if SDL.exitOnCrash == true then
-      quit(exit_codes.aborted)
-    end
+    runStep(function()
+      SDL:StopSDL()
+      if SDL.exitOnCrash == true then
+        xmlReporter.flush()
+        quit(exit_codes.aborted)
+      end
+      control:next()
+    end)
+    return
   end
   control:next()
 end
@@ -259,6 +293,7 @@ end
 --- Skipp the current Test execution
 -- @param self TestBase table
 local function SkipTest(self)
+  xmlReporter.flush()
   quit(exit_codes.skipped)
 end
 
@@ -272,12 +307,14 @@ end
 --- Execute 'func' after defined timeout
 local function runAfter(self, func, timeout)
   local d = qt.dynamic()
-  d.timeout = function(pTimer)
+  local timer = timers.Timer()
+  d.timeout = function()
     func()
-    self.timers[pTimer] = nil
+    -- Disconnection releases the proxy, so both it and the timer can be collected
+    qt.disconnect(timer, "timeout()", d, "timeout()")
+    self.timers[timer] = nil
   end
 
-  local timer = timers.Timer()
   self.timers[timer] = true
   qt.connect(timer, "timeout()", d, "timeout()")
   timer:setSingleShot(true)
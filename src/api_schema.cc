@@ -0,0 +1,780 @@
+#include "api_schema.h"
+#include "json.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+const char *kMessageTypes[] = { "request", "response", "notification" };
+const int kMessageTypesCount = 3;
+
+enum TypeCode {
+  kNumber,
+  kString,
+  kBoolean,
+  kEnum,
+  kStruct,
+  kUnknown
+};
+
+struct Enum {
+  QHash<QByteArray, bool> names;
+  std::vector<lua_Number> values;  // sorted
+};
+
+struct Struct;
+
+struct Param {
+  std::string name;
+  std::string typeName;
+  TypeCode type;
+  const Enum *enumType;
+  const Struct *structType;
+  bool array;
+  bool mandatory;
+  bool hasMinSize;
+  bool hasMaxSize;
+  lua_Number minSize;
+  lua_Number maxSize;
+};
+
+// Parameters of a struct or a function
+struct Struct {
+  std::vector<Param> params;
+  QHash<QByteArray, int> index;
+};
+
+struct Interface {
+  QHash<QByteArray, const Enum*> enums;
+  QHash<QByteArray, Struct*> structs;
+  QHash<QByteArray, const Struct*> functions[kMessageTypesCount];
+};
+
+// Error messages of checked parameters: parameter name and message
+typedef std::vector<std::pair<std::string, std::string> > Entries;
+
+std::string number_to_string(lua_Number value) {
+  char buffer[64];
+  const int len = snprintf(buffer, sizeof(buffer), LUA_NUMBER_FMT, value);
+  return std::string(buffer, len);
+}
+
+// tostring() of a table key, without converting numbers in place
+std::string key_to_string(lua_State *L, int idx) {
+  if (lua_type(L, idx) == LUA_TNUMBER) {
+    return number_to_string(lua_tonumberx(L, idx, NULL));
+  }
+  lua_pushvalue(L, idx);
+  size_t len;
+  const char *s = luaL_tolstring(L, -1, &len);
+  std::string result(s, len);
+  lua_pop(L, 2);
+  return result;
+}
+
+QByteArray to_key(lua_State *L, int idx) {
+  size_t len;
+  const char *s = lua_tolstring(L, idx, &len);
+  return QByteArray::fromRawData(s, static_cast<int>(len));
+}
+
+// Same as json.isArray with the exception of empty tables, which are always arrays here
+bool is_array(lua_State *L, int idx) {
+  if (!lua_istable(L, idx)) {
+    return false;
+  }
+  lua_pushnil(L);
+  while (lua_next(L, idx)) {
+    lua_pop(L, 1);
+    const lua_Number key = lua_type(L, -1) == LUA_TNUMBER ? lua_tonumberx(L, -1, NULL) : 0;
+    if (key < 1 || static_cast<lua_Number>(static_cast<lua_Integer>(key)) != key) {
+      lua_pop(L, 1);
+      return false;
+    }
+  }
+  return true;
+}
+
+int count_pairs(lua_State *L, int idx) {
+  int count = 0;
+  lua_pushnil(L);
+  while (lua_next(L, idx)) {
+    lua_pop(L, 1);
+    ++count;
+  }
+  return count;
+}
+
+// Validation schema compiled from the tables built by api_loader.
+// The checks and messages replicate the schema_validation module rules.
+class Schema {
+ public:
+  void compile(lua_State *L, int idx);
+  void compare(lua_State *L, const char *functionId, const char *messageType, int dataIdx);
+
+ private:
+  void loadParams(lua_State *L, int idx, Struct *dest);
+  void resolveType(Param *param) const;
+  const Interface *interface(const QByteArray &name) const { return interfaces_.value(name, NULL); }
+
+  bool checkParams(lua_State *L, int idx, const Struct &schema, const std::string *structName, Entries *entries);
+  bool checkArray(lua_State *L, int idx, const Param &param, const std::string &name, std::string *messages);
+  bool compareType(lua_State *L, int idx, const Param &param, bool asArray, const std::string &name,
+                   const std::string *structName, std::string *messages);
+
+  std::vector<std::unique_ptr<Interface> > interfacesStorage_;
+  std::vector<std::unique_ptr<Enum> > enumsStorage_;
+  std::vector<std::unique_ptr<Struct> > structsStorage_;
+  QHash<QByteArray, Interface*> interfaces_;
+  QByteArray firstInterface_;
+};
+
+// Splits "Interface.Name", unqualified names refer to the first interface of the schema
+void split_name(const QByteArray &fullName, const QByteArray &firstInterface, QByteArray *interface, QByteArray *name) {
+  const int dot = fullName.indexOf('.');
+  if (dot < 0) {
+    *interface = firstInterface;
+    *name = fullName;
+    return;
+  }
+  *interface = fullName.left(dot);
+  const int next = fullName.indexOf('.', dot + 1);
+  *name = fullName.mid(dot + 1, next < 0 ? -1 : next - dot - 1);
+}
+
+void Schema::compile(lua_State *L, int idx) {
+  lua_getfield(L, idx, "interface");
+  luaL_checktype(L, -1, LUA_TTABLE);
+  const int interfacesIdx = lua_gettop(L);
+
+  // Types are created before loading any parameter as parameters may refer to them
+  lua_pushnil(L);
+  while (lua_next(L, interfacesIdx)) {
+    if (lua_type(L, -2) != LUA_TSTRING || !lua_istable(L, -1)) {
+      lua_pop(L, 1);
+      continue;
+    }
+    const QByteArray name(lua_tostring(L, -2));
+    Interface *iface = new Interface();
+    interfacesStorage_.push_back(std::unique_ptr<Interface>(iface));
+    interfaces_.insert(name, iface);
+    if (firstInterface_.isEmpty()) {
+      firstInterface_ = name;
+    }
+
+    lua_getfield(L, -1, "enum");
+    if (lua_istable(L, -1)) {
+      lua_pushnil(L);
+      while (lua_next(L, -2)) {
+        if (lua_type(L, -2) == LUA_TSTRING && lua_istable(L, -1)) {
+          Enum *e = new Enum();
+          enumsStorage_.push_back(std::unique_ptr<Enum>(e));
+          iface->enums.insert(QByteArray(lua_tostring(L, -2)), e);
+          lua_pushnil(L);
+          while (lua_next(L, -2)) {
+            if (lua_type(L, -2) == LUA_TSTRING) {
+              e->names.insert(QByteArray(lua_tostring(L, -2)), true);
+            }
+            if (lua_type(L, -1) == LUA_TNUMBER) {
+              e->values.push_back(lua_tonumberx(L, -1, NULL));
+            }
+            lua_pop(L, 1);
+          }
+          std::sort(e->values.begin(), e->values.end());
+        }
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+
+    lua_getfield(L, -1, "struct");
+    if (lua_istable(L, -1)) {
+      lua_pushnil(L);
+      while (lua_next(L, -2)) {
+        if (lua_type(L, -2) == LUA_TSTRING) {
+          Struct *s = new Struct();
+          structsStorage_.push_back(std::unique_ptr<Struct>(s));
+          iface->structs.insert(QByteArray(lua_tostring(L, -2)), s);
+        }
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 2);
+  }
+
+  lua_pushnil(L);
+  while (lua_next(L, interfacesIdx)) {
+    if (lua_type(L, -2) != LUA_TSTRING || !lua_istable(L, -1)) {
+      lua_pop(L, 1);
+      continue;
+    }
+    Interface *iface = interfaces_.value(QByteArray(lua_tostring(L, -2)), NULL);
+
+    lua_getfield(L, -1, "struct");
+    if (lua_istable(L, -1)) {
+      lua_pushnil(L);
+      while (lua_next(L, -2)) {
+        if (lua_type(L, -2) == LUA_TSTRING && lua_istable(L, -1)) {
+          lua_getfield(L, -1, "param");
+          loadParams(L, lua_gettop(L), iface->structs.value(QByteArray(lua_tostring(L, -3)), NULL));
+          lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+
+    lua_getfield(L, -1, "type");
+    for (int i = 0; i < kMessageTypesCount && lua_istable(L, -1); ++i) {
+      lua_getfield(L, -1, kMessageTypes[i]);
+      if (lua_istable(L, -1)) {
+        lua_getfield(L, -1, "functions");
+        if (lua_istable(L, -1)) {
+          lua_pushnil(L);
+          while (lua_next(L, -2)) {
+            if (lua_type(L, -2) == LUA_TSTRING && lua_istable(L, -1)) {
+              Struct *f = new Struct();
+              structsStorage_.push_back(std::unique_ptr<Struct>(f));
+              iface->functions[i].insert(QByteArray(lua_tostring(L, -2)), f);
+              lua_getfield(L, -1, "param");
+              loadParams(L, lua_gettop(L), f);
+              lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+          }
+        }
+        lua_pop(L, 1);
+      }
+      lua_pop(L, 1);
+    }
+    lua_pop(L, 2);
+  }
+  lua_pop(L, 1);
+}
+
+void Schema::loadParams(lua_State *L, int idx, Struct *dest) {
+  if (!dest || !lua_istable(L, idx)) {
+    return;
+  }
+  lua_pushnil(L);
+  while (lua_next(L, idx)) {
+    if (lua_type(L, -2) != LUA_TSTRING || !lua_istable(L, -1)) {
+      lua_pop(L, 1);
+      continue;
+    }
+    Param param;
+    param.name = lua_tostring(L, -2);
+    lua_getfield(L, -1, "type");
+    param.typeName = lua_isstring(L, -1) ? lua_tostring(L, -1) : "";
+    lua_pop(L, 1);
+    // api_loader keeps XML attribute strings, booleans are defaults for absent attributes
+    lua_getfield(L, -1, "array");
+    param.array = lua_type(L, -1) == LUA_TSTRING && strcmp(lua_tostring(L, -1), "true") == 0;
+    lua_pop(L, 1);
+    lua_getfield(L, -1, "mandatory");
+    param.mandatory = lua_isboolean(L, -1) && lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    lua_getfield(L, -1, "minsize");
+    param.hasMinSize = lua_type(L, -1) == LUA_TNUMBER;
+    param.minSize = lua_tonumberx(L, -1, NULL);
+    lua_pop(L, 1);
+    lua_getfield(L, -1, "maxsize");
+    param.hasMaxSize = lua_type(L, -1) == LUA_TNUMBER;
+    param.maxSize = lua_tonumberx(L, -1, NULL);
+    lua_pop(L, 1);
+    resolveType(&param);
+
+    dest->index.insert(QByteArray(param.name.c_str()), static_cast<int>(dest->params.size()));
+    dest->params.push_back(param);
+    lua_pop(L, 1);
+  }
+}
+
+void Schema::resolveType(Param *param) const {
+  param->enumType = NULL;
+  param->structType = NULL;
+  const std::string &t = param->typeName;
+  if (t == "Integer" || t == "Float" || t == "Double") {
+    param->type = kNumber;
+    return;
+  }
+  if (t == "String") {
+    param->type = kString;
+    return;
+  }
+  if (t == "Boolean") {
+    param->type = kBoolean;
+    return;
+  }
+  QByteArray ifaceName, name;
+  split_name(QByteArray(t.c_str()), firstInterface_, &ifaceName, &name);
+  const Interface *iface = interface(ifaceName);
+  param->type = kUnknown;
+  if (!iface) {
+    return;
+  }
+  if ((param->enumType = iface->enums.value(name, NULL))) {
+    param->type = kEnum;
+  } else if ((param->structType = iface->structs.value(name, NULL))) {
+    param->type = kStruct;
+  }
+}
+
+// Checks members of table at idx against parameters of schema.
+// Adds a message (possibly empty) for each member to entries.
+bool Schema::checkParams(lua_State *L, int idx, const Struct &schema, const std::string *structName, Entries *entries) {
+  if (!lua_istable(L, idx)) {
+    return false;
+  }
+  bool result = true;
+  bool arraysResult = true;
+  bool typesResult = true;
+  lua_pushnil(L);
+  while (lua_next(L, idx)) {
+    const int valueIdx = lua_gettop(L);
+    const std::string key = key_to_string(L, -2);
+    const int i = lua_type(L, -2) == LUA_TSTRING ? schema.index.value(to_key(L, -2), -1) : -1;
+    if (i < 0) {
+      result = false;
+      entries->push_back(std::make_pair(key, "Invalid parameter " + key + ", not existing in API schema"));
+    } else {
+      const Param &param = schema.params[i];
+      std::string messages;
+      if (param.array) {
+        arraysResult = checkArray(L, valueIdx, param, key, &messages) && arraysResult;
+      }
+      typesResult = compareType(L, valueIdx, param, param.array, key, structName, &messages) && typesResult;
+      entries->push_back(std::make_pair(key, messages));
+    }
+    lua_pop(L, 1);
+  }
+  return result && arraysResult && typesResult;
+}
+
+bool Schema::checkArray(lua_State *L, int idx, const Param &param, const std::string &name, std::string *messages) {
+  if (!is_array(L, idx)) {
+    return false;
+  }
+  const lua_Number size = count_pairs(L, idx);
+  std::string warnings;
+  if (param.hasMinSize) {
+    if (size < param.minSize) {
+      *messages += "n array get size: " + number_to_string(size) + ", expected minsize:"
+        + number_to_string(param.minSize) + "\n";
+      return false;
+    }
+  } else {
+    warnings += "WARNING: Problem with API schema " + name + ": \"minsize\" does not present in schema with array\n";
+  }
+  if (param.hasMaxSize) {
+    if (size > param.maxSize) {
+      *messages += "in array get size: " + number_to_string(size) + ", expected maxsize:"
+        + number_to_string(param.maxSize) + "\n";
+      return false;
+    }
+  } else {
+    warnings += "WARNING: Problem with API schema " + name + ": \"maxsize\" does not present in schema with array\n";
+  }
+  *messages += warnings;
+  return true;
+}
+
+bool Schema::compareType(lua_State *L, int idx, const Param &param, bool asArray, const std::string &name,
+                         const std::string *structName, std::string *messages) {
+  const std::string fullName = structName ? *structName + "." + name : name;
+  const std::string got = "Parameter " + fullName + ": got " + luaL_typename(L, idx) + ", expected ";
+  if (asArray) {
+    if (!is_array(L, idx)) {
+      *messages += got + "Array\n";
+      return false;
+    }
+    // As in schema_validation the result of the last element is the result of the array
+    bool result = true;
+    lua_pushnil(L);
+    while (lua_next(L, idx)) {
+      result = compareType(L, lua_gettop(L), param, false, name + "." + key_to_string(L, -2), structName, messages);
+      lua_pop(L, 1);
+    }
+    return result;
+  }
+
+  switch (param.type) {
+    case kNumber:
+      if (lua_type(L, idx) == LUA_TNUMBER) {
+        return true;
+      }
+      break;
+    case kString:
+      if (lua_type(L, idx) == LUA_TSTRING) {
+        return true;
+      }
+      break;
+    case kBoolean:
+      if (lua_type(L, idx) == LUA_TBOOLEAN) {
+        return true;
+      }
+      break;
+    case kEnum:
+      if (lua_type(L, idx) == LUA_TSTRING && param.enumType->names.contains(to_key(L, idx))) {
+        return true;
+      }
+      if (lua_type(L, idx) == LUA_TNUMBER) {
+        const lua_Number value = lua_tonumberx(L, idx, NULL);
+        if (!std::binary_search(param.enumType->values.begin(), param.enumType->values.end(), value)) {
+          *messages += "[WARNING]: got non-existed integer value \"" + number_to_string(value) + "\" in enum "
+            + param.typeName + "\n";
+        }
+        return true;
+      }
+      *messages += got + "enum value: " + param.typeName + "\n";
+      return false;
+    case kStruct: {
+      if (!lua_istable(L, idx)) {
+        *messages += got + "struct: " + param.typeName + "\n";
+        return false;
+      }
+      // Missing mandatory members are reported, but do not fail the check
+      Entries entries;
+      const std::vector<Param> &members = param.structType->params;
+      for (std::vector<Param>::const_iterator it = members.begin(); it != members.end(); ++it) {
+        if (!it->mandatory) {
+          continue;
+        }
+        lua_getfield(L, idx, it->name.c_str());
+        if (lua_isnil(L, -1)) {
+          entries.push_back(std::make_pair(std::string(),
+            "mandatory parameter " + fullName + "." + it->name + " not present"));
+        }
+        lua_pop(L, 1);
+      }
+      const bool result = checkParams(L, idx, *param.structType, &fullName, &entries);
+      for (Entries::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (!it->second.empty()) {
+          *messages += it->second + "\n";
+        }
+      }
+      return result;
+    }
+    case kUnknown:
+      break;
+  }
+  *messages += got + param.typeName + "\n";
+  return false;
+}
+
+// Pushes result and error messages: { [function name] = { [parameter] = message } }
+void Schema::compare(lua_State *L, const char *functionId, const char *messageType, int dataIdx) {
+  QByteArray ifaceName, name;
+  split_name(QByteArray(functionId), firstInterface_, &ifaceName, &name);
+  int type = 0;
+  while (type < kMessageTypesCount && strcmp(kMessageTypes[type], messageType) != 0) {
+    ++type;
+  }
+  const Interface *iface = interface(ifaceName);
+  const Struct *function = iface && type < kMessageTypesCount ? iface->functions[type].value(name, NULL) : NULL;
+  if (!function) {
+    lua_pushboolean(L, 0);
+    lua_newtable(L);
+    lua_pushfstring(L, "function %s has not been found in schema", name.constData());
+    lua_setfield(L, -2, name.constData());
+    return;
+  }
+
+  Entries entries;
+  const bool result = checkParams(L, dataIdx, *function, NULL, &entries);
+  lua_pushboolean(L, result);
+  lua_newtable(L);
+  lua_createtable(L, 0, static_cast<int>(entries.size()));
+  for (Entries::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+    lua_pushlstring(L, it->second.data(), it->second.size());
+    lua_setfield(L, -2, it->first.c_str());
+  }
+  lua_setfield(L, -2, name.constData());
+}
+
+// api_schema.compile(schema)
+// Compiles interfaces table built by api_loader into a Schema object.
+int api_schema_compile(lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  Schema **p = static_cast<Schema**>(lua_newuserdata(L, sizeof(Schema*)));
+  *p = new Schema();
+  luaL_getmetatable(L, "api_schema.Schema");
+  lua_setmetatable(L, -2);
+  (*p)->compile(L, 1);
+  return 1;
+}
+
+// schema:Compare(function_id, function_type, data)
+// Returns the validation result and error messages table like Validator:Compare.
+// Lazy data (see json.lazy) is decoded before any C++ object is created,
+// as decoding malformed text raises a Lua error.
+int api_schema_compare(lua_State *L) {
+  Schema *schema = *static_cast<Schema**>(luaL_checkudata(L, 1, "api_schema.Schema"));
+  const char *functionId = luaL_checkstring(L, 2);
+  const char *messageType = luaL_checkstring(L, 3);
+  if (lua_isnoneornil(L, 4)) {
+    lua_settop(L, 3);
+    lua_newtable(L);
+  }
+  lua_settop(L, 4);
+  json_materialize(L, 4);
+  schema->compare(L, functionId, messageType, 4);
+  return 2;
+}
+
+// Schema cache file: magic with format version, SHA-1 of the API XML file
+// and the image of the tables built by api_loader.
+const char kCacheMagic[8] = { 'A', 'T', 'F', 'A', 'P', 'I', '\0', '\1' };
+const int kCacheMaxDepth = 64;
+
+enum CacheTag {
+  kCacheTable = 'T',
+  kCacheString = 'S',
+  kCacheNumber = 'N',
+  kCacheTrue = 'B',
+  kCacheFalse = 'F'
+};
+
+bool is_cacheable(lua_State *L, int idx) {
+  const int type = lua_type(L, idx);
+  return type == LUA_TSTRING || type == LUA_TNUMBER || type == LUA_TBOOLEAN || type == LUA_TTABLE;
+}
+
+// Serializes strings, numbers, booleans and tables of them.
+// Members of other types (such as XML nodes kept by api_loader) are skipped.
+class CacheWriter {
+ public:
+  explicit CacheWriter(QByteArray *out) : out_(out) { }
+
+  bool write(lua_State *L, int idx, int depth = 0) {
+    switch (lua_type(L, idx)) {
+      case LUA_TSTRING: {
+        size_t len;
+        const char *s = lua_tolstring(L, idx, &len);
+        out_->append(static_cast<char>(kCacheString));
+        writeUint32(static_cast<quint32>(len));
+        out_->append(s, static_cast<int>(len));
+        return true;
+      }
+      case LUA_TNUMBER: {
+        const lua_Number value = lua_tonumberx(L, idx, NULL);
+        out_->append(static_cast<char>(kCacheNumber));
+        out_->append(reinterpret_cast<const char*>(&value), sizeof(value));
+        return true;
+      }
+      case LUA_TBOOLEAN:
+        out_->append(static_cast<char>(lua_toboolean(L, idx) ? kCacheTrue : kCacheFalse));
+        return true;
+      case LUA_TTABLE:
+        return writeTable(L, lua_absindex(L, idx), depth);
+      default:
+        return false;
+    }
+  }
+
+ private:
+  bool writeTable(lua_State *L, int idx, int depth) {
+    if (depth >= kCacheMaxDepth || !lua_checkstack(L, 3)) {
+      return false;
+    }
+    out_->append(static_cast<char>(kCacheTable));
+    const int countPos = out_->size();
+    writeUint32(0);
+    quint32 count = 0;
+    lua_pushnil(L);
+    while (lua_next(L, idx)) {
+      if (is_cacheable(L, -2) && is_cacheable(L, -1)) {
+        if (!write(L, -2, depth + 1) || !write(L, -1, depth + 1)) {
+          lua_pop(L, 2);
+          return false;
+        }
+        ++count;
+      }
+      lua_pop(L, 1);
+    }
+    memcpy(out_->data() + countPos, &count, sizeof(count));
+    return true;
+  }
+
+  void writeUint32(quint32 value) {
+    out_->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  QByteArray *out_;
+};
+
+// Builds Lua values back from the cache image, fails on any malformed data
+class CacheReader {
+ public:
+  CacheReader(const uchar *data, qint64 size) : data_(data), size_(size), pos_(0) { }
+
+  // Pushes the value on success, leaves the stack untouched otherwise
+  bool read(lua_State *L, int depth = 0) {
+    if (pos_ >= size_ || depth >= kCacheMaxDepth || !lua_checkstack(L, 3)) {
+      return false;
+    }
+    const char tag = static_cast<char>(data_[pos_++]);
+    switch (tag) {
+      case kCacheString: {
+        quint32 len;
+        if (!readRaw(&len, sizeof(len)) || size_ - pos_ < len) {
+          return false;
+        }
+        lua_pushlstring(L, reinterpret_cast<const char*>(data_ + pos_), len);
+        pos_ += len;
+        return true;
+      }
+      case kCacheNumber: {
+        lua_Number value;
+        if (!readRaw(&value, sizeof(value))) {
+          return false;
+        }
+        lua_pushnumber(L, value);
+        return true;
+      }
+      case kCacheTrue:
+      case kCacheFalse:
+        lua_pushboolean(L, tag == kCacheTrue);
+        return true;
+      case kCacheTable: {
+        quint32 count;
+        if (!readRaw(&count, sizeof(count))) {
+          return false;
+        }
+        lua_createtable(L, 0, static_cast<int>(qMin<quint32>(count, size_ - pos_)));
+        for (quint32 i = 0; i < count; ++i) {
+          if (!read(L, depth + 1)) {
+            lua_pop(L, 1);
+            return false;
+          }
+          if (!read(L, depth + 1)) {
+            lua_pop(L, 2);
+            return false;
+          }
+          lua_rawset(L, -3);
+        }
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+ private:
+  bool readRaw(void *dest, size_t len) {
+    if (static_cast<size_t>(size_ - pos_) < len) {
+      return false;
+    }
+    memcpy(dest, data_ + pos_, len);
+    pos_ += len;
+    return true;
+  }
+
+  const uchar *data_;
+  qint64 size_;
+  qint64 pos_;
+};
+
+QByteArray file_hash(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QByteArray();
+  }
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(&file);
+  return hash.result();
+}
+
+// api_schema.load_cache(xml_path, cache_path)
+// Returns the tables stored by store_cache if the cache was built from the same XML, nil otherwise.
+int api_schema_load_cache(lua_State *L) {
+  const QString xmlPath = QString::fromUtf8(luaL_checkstring(L, 1));
+  const QString cachePath = QString::fromUtf8(luaL_checkstring(L, 2));
+  lua_settop(L, 2);
+  const QByteArray hash = file_hash(xmlPath);
+  QFile file(cachePath);
+  const qint64 headerSize = sizeof(kCacheMagic) + hash.size();
+  if (hash.isEmpty() || !file.open(QIODevice::ReadOnly) || file.size() < headerSize) {
+    lua_pushnil(L);
+    return 1;
+  }
+  const qint64 size = file.size();
+  QByteArray contents;
+  const uchar *data = file.map(0, size);
+  if (!data) {
+    contents = file.readAll();
+    data = reinterpret_cast<const uchar*>(contents.constData());
+  }
+  if (memcmp(data, kCacheMagic, sizeof(kCacheMagic)) != 0
+      || memcmp(data + sizeof(kCacheMagic), hash.constData(), hash.size()) != 0) {
+    lua_pushnil(L);
+    return 1;
+  }
+  CacheReader reader(data + headerSize, size - headerSize);
+  if (!reader.read(L) || !lua_istable(L, -1)) {
+    lua_settop(L, 2);
+    lua_pushnil(L);
+  }
+  return 1;
+}
+
+// api_schema.store_cache(xml_path, cache_path, schema)
+// Stores tables built by api_loader from xml_path, the file is replaced atomically.
+// Returns true on success.
+int api_schema_store_cache(lua_State *L) {
+  const QString xmlPath = QString::fromUtf8(luaL_checkstring(L, 1));
+  const QString cachePath = QString::fromUtf8(luaL_checkstring(L, 2));
+  luaL_checktype(L, 3, LUA_TTABLE);
+  const QByteArray hash = file_hash(xmlPath);
+  bool stored = false;
+  if (!hash.isEmpty()) {
+    QByteArray image(kCacheMagic, sizeof(kCacheMagic));
+    image.append(hash);
+    if (CacheWriter(&image).write(L, 3)) {
+      QSaveFile file(cachePath);
+      stored = file.open(QIODevice::WriteOnly) && file.write(image) == image.size() && file.commit();
+    }
+  }
+  lua_pushboolean(L, stored);
+  return 1;
+}
+
+int api_schema_delete(lua_State *L) {
+  Schema *schema = *static_cast<Schema**>(luaL_checkudata(L, 1, "api_schema.Schema"));
+  delete schema;
+  return 0;
+}
+}  // anonymous namespace
+
+int luaopen_api_schema(lua_State *L) {
+  luaL_newmetatable(L, "api_schema.Schema");
+  lua_newtable(L);
+  luaL_Reg schema_functions[] = {
+    { "Compare", &api_schema_compare },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, schema_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, &api_schema_delete);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+
+  luaL_Reg api_schema_functions[] = {
+    { "compile", &api_schema_compile },
+    { "load_cache", &api_schema_load_cache },
+    { "store_cache", &api_schema_store_cache },
+    { NULL, NULL }
+  };
+  luaL_newlib(L, api_schema_functions);
+  return 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+int luaopen_api_schema(lua_State *L);
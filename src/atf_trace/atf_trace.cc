@@ -0,0 +1,112 @@
+#include "trace.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+void usage(const char *program) {
+  fprintf(stderr,
+      "Usage: %s [OPTION]... TRACE_FILE\n"
+      "Render binary ATF trace as text ATF log.\n"
+      "\n"
+      "  -o FILE       write to FILE instead of standard output\n"
+      "  -d DIRECTION  only messages of DIRECTION (MOB->SDL, SDL->MOB, HMI->SDL, SDL->HMI)\n"
+      "  -f TEXT       only messages containing TEXT in function name (mobile)\n"
+      "                or in message (HMI)\n"
+      "  -s SESSION    only mobile messages of SESSION id\n"
+      "  -m            only messages, skip test step and summary lines\n"
+      "  -h            show this help\n", program);
+}
+
+struct Filter {
+  const char *direction;
+  const char *text;
+  const char *session;
+  bool messagesOnly;
+};
+
+bool matches(const atf_trace::Record &record, const Filter &filter) {
+  if (record.kind == atf_trace::kText) {
+    return !filter.messagesOnly;
+  }
+  if (filter.direction && record.fields[0].str != filter.direction) {
+    return false;
+  }
+  if (filter.text && record.fields[1].str.find(filter.text) == std::string::npos) {
+    return false;
+  }
+  if (filter.session) {
+    if (record.kind != atf_trace::kMobile) {
+      return false;
+    }
+    std::string session;
+    const atf_trace::Value &value = record.fields[2];
+    if (value.type == atf_trace::kInteger || value.type == atf_trace::kNumber) {
+      char buffer[32];
+      snprintf(buffer, sizeof(buffer), "%.14g", value.number);
+      session = buffer;
+    }
+    if (session != filter.session) {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+int main(int argc, char *argv[]) {
+  Filter filter = { NULL, NULL, NULL, false };
+  const char *output = NULL;
+  int option;
+  while ((option = getopt(argc, argv, "o:d:f:s:mh")) != -1) {
+    switch (option) {
+      case 'o': output = optarg; break;
+      case 'd': filter.direction = optarg; break;
+      case 'f': filter.text = optarg; break;
+      case 's': filter.session = optarg; break;
+      case 'm': filter.messagesOnly = true; break;
+      case 'h': usage(argv[0]); return EXIT_SUCCESS;
+      default: usage(argv[0]); return EXIT_FAILURE;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *filename = argv[optind];
+  FILE *in = fopen(filename, "rb");
+  if (!in) {
+    fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+    return EXIT_FAILURE;
+  }
+  FILE *out = stdout;
+  if (output && !(out = fopen(output, "w"))) {
+    fprintf(stderr, "%s: %s\n", output, strerror(errno));
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+
+  atf_trace::Reader reader(in);
+  atf_trace::Record record;
+  std::string line;
+  if (reader.readHeader()) {
+    while (reader.next(&record)) {
+      if (matches(record, filter)) {
+        atf_trace::formatText(record, reader.wallTime(record.time), &line);
+        fwrite(line.data(), 1, line.size(), out);
+      }
+    }
+  }
+  fclose(in);
+  if (out != stdout) {
+    fclose(out);
+  }
+  if (!reader.error().empty()) {
+    fprintf(stderr, "%s: %s\n", filename, reader.error().c_str());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
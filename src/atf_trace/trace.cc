@@ -0,0 +1,335 @@
+#include "trace.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+namespace atf_trace {
+
+namespace {
+const char kMagic[8] = { 'A', 'T', 'F', 'T', 'R', 'A', 'C', 'E' };
+const int kHeaderSize = sizeof(kMagic) + sizeof(uint32_t) + 2 * sizeof(int64_t);
+const int kExtraNewline = 1;
+const char *kMobileLabels[] = {
+  "sessionId: ", "version: ", "frameType: ", "encryption: ",
+  "serviceType: ", "frameInfo: ", "messageId: ", "binaryDataSize: "
+};
+
+int64_t clock_ns(clockid_t clock) {
+  struct timespec time;
+  clock_gettime(clock, &time);
+  return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+template <typename T>
+void append(std::string *out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool take(const char **pos, const char *end, T *value) {
+  if (end - *pos < static_cast<ptrdiff_t>(sizeof(T))) {
+    return false;
+  }
+  memcpy(value, *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+void append_value(const Value &value, std::string *out) {
+  char buffer[32];
+  switch (value.type) {
+    case kNil:
+      out->append("nil");
+      break;
+    case kBoolean:
+      out->append(value.number ? "true" : "false");
+      break;
+    case kInteger:
+    case kNumber:
+      snprintf(buffer, sizeof(buffer), "%.14g", value.number);  // LUA_NUMBER_FMT
+      out->append(buffer);
+      break;
+    default:
+      out->append(value.str);
+  }
+}
+
+// Same as Logger.formated_time(): "dd-MM-yyyy hh:mm:ss,zzz"
+void append_time(int64_t time, std::string *out) {
+  const time_t seconds = time / 1000000000;
+  struct tm local;
+  localtime_r(&seconds, &local);
+  char buffer[32];
+  const size_t size = strftime(buffer, sizeof(buffer), "%d-%m-%Y %H:%M:%S", &local);
+  snprintf(buffer + size, sizeof(buffer) - size, ",%03d",
+           static_cast<int>(time % 1000000000 / 1000000));
+  out->append(buffer);
+}
+}
+
+int fieldCount(RecordKind kind) {
+  switch (kind) {
+    case kText: return 1;
+    case kMobile: return 11;
+    case kHmi: return 2;
+    default: return 0;
+  }
+}
+
+int64_t wallClock() {
+  return clock_ns(CLOCK_REALTIME);
+}
+
+int64_t monotonicClock() {
+  return clock_ns(CLOCK_MONOTONIC);
+}
+
+void formatText(const Record &record, int64_t time, std::string *out) {
+  out->clear();
+  switch (record.kind) {
+    case kText:
+      append_value(record.fields[0], out);
+      break;
+    case kMobile:
+      // "%s [%s] [%s, sessionId: %s, ... binaryDataSize: %s] : %s \n\n"
+      append_value(record.fields[0], out);
+      out->append(" [");
+      append_time(time, out);
+      out->append("] [");
+      append_value(record.fields[1], out);
+      for (int i = 0; i < 8; ++i) {
+        out->append(", ");
+        out->append(kMobileLabels[i]);
+        append_value(record.fields[i + 2], out);
+      }
+      out->append("] : ");
+      append_value(record.fields[10], out);
+      out->append(" \n\n");
+      break;
+    case kHmi:
+      // "%s [%s] %s \n"
+      append_value(record.fields[0], out);
+      out->append(" [");
+      append_time(time, out);
+      out->append("] ");
+      append_value(record.fields[1], out);
+      if (record.extraNewline) {
+        out->append("\n");
+      }
+      out->append(" \n");
+      break;
+    default:
+      break;
+  }
+}
+
+Writer::Writer(FILE *file, int64_t wallTime, int64_t monotonicTime)
+  : file_(file) {
+  std::string header(kMagic, sizeof(kMagic));
+  append(&header, kVersion);
+  append(&header, wallTime);
+  append(&header, monotonicTime);
+  fwrite(header.data(), 1, header.size(), file_);
+}
+
+bool Writer::write(const Record &record) {
+  pending_.clear();
+  beginRecord(record.kind, record.extraNewline, record.time);
+  const int count = fieldCount(record.kind);
+  for (int i = 0; i < count; ++i) {
+    const bool intern = (record.kind == kMobile && i < 2) || (record.kind == kHmi && i == 0);
+    writeValue(record.fields[i], intern);
+  }
+  if (!pending_.empty() && fwrite(pending_.data(), 1, pending_.size(), file_) != pending_.size()) {
+    return false;
+  }
+  return endRecord();
+}
+
+void Writer::beginRecord(RecordKind kind, bool extraNewline, int64_t time) {
+  record_.clear();
+  append(&record_, uint32_t(0));
+  append(&record_, uint8_t(kind));
+  append(&record_, uint8_t(extraNewline ? kExtraNewline : 0));
+  append(&record_, time);
+}
+
+bool Writer::endRecord() {
+  const uint32_t size = record_.size() - sizeof(uint32_t);
+  memcpy(&record_[0], &size, sizeof(size));
+  return fwrite(record_.data(), 1, record_.size(), file_) == record_.size();
+}
+
+void Writer::writeValue(const Value &value, bool intern) {
+  switch (value.type) {
+    case kNil:
+      append(&record_, uint8_t(kNil));
+      break;
+    case kBoolean:
+      append(&record_, uint8_t(kBoolean));
+      append(&record_, uint8_t(value.number ? 1 : 0));
+      break;
+    case kInteger:
+    case kNumber:
+      // Protocol header fields are small integers, keep them in 4 bytes
+      if (value.number == floor(value.number)
+          && value.number >= INT32_MIN && value.number <= INT32_MAX) {
+        append(&record_, uint8_t(kInteger));
+        append(&record_, int32_t(value.number));
+      } else {
+        append(&record_, uint8_t(kNumber));
+        append(&record_, value.number);
+      }
+      break;
+    default:
+      if (intern) {
+        append(&record_, uint8_t(kStringRef));
+        append(&record_, internString(value.str));
+      } else {
+        append(&record_, uint8_t(kString));
+        append(&record_, uint32_t(value.str.size()));
+        record_.append(value.str);
+      }
+  }
+}
+
+uint32_t Writer::internString(const std::string &str) {
+  std::unordered_map<std::string, uint32_t>::const_iterator it = strings_.find(str);
+  if (it != strings_.end()) {
+    return it->second;
+  }
+  const uint32_t id = strings_.size();
+  strings_.insert(std::make_pair(str, id));
+  append(&pending_, uint32_t(1 + 1 + sizeof(int64_t) + sizeof(id) + str.size()));
+  append(&pending_, uint8_t(kStringDef));
+  append(&pending_, uint8_t(0));
+  append(&pending_, int64_t(0));
+  append(&pending_, id);
+  pending_.append(str);
+  return id;
+}
+
+Reader::Reader(FILE *file)
+  : file_(file), wallTime_(0), monotonicTime_(0) { }
+
+bool Reader::readHeader() {
+  char header[kHeaderSize];
+  if (fread(header, 1, sizeof(header), file_) != sizeof(header)
+      || memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+    error_ = "not an ATF trace";
+    return false;
+  }
+  const char *pos = header + sizeof(kMagic);
+  const char *end = header + sizeof(header);
+  uint32_t version;
+  take(&pos, end, &version);
+  take(&pos, end, &wallTime_);
+  take(&pos, end, &monotonicTime_);
+  if (version != kVersion) {
+    error_ = "unsupported ATF trace version";
+    return false;
+  }
+  return true;
+}
+
+bool Reader::next(Record *record) {
+  while (true) {
+    uint32_t size;
+    const size_t read = fread(&size, 1, sizeof(size), file_);
+    if (read == 0 && feof(file_)) {
+      return false;
+    }
+    if (read == sizeof(size)) {
+      record_.resize(size);
+    }
+    if (read != sizeof(size) || fread(&record_[0], 1, size, file_) != size) {
+      error_ = "truncated record";
+      return false;
+    }
+    const char *pos = record_.data();
+    const char *end = pos + record_.size();
+    uint8_t kind, flags;
+    if (!take(&pos, end, &kind) || !take(&pos, end, &flags) || !take(&pos, end, &record->time)) {
+      error_ = "truncated record";
+      return false;
+    }
+    if (kind == kStringDef) {
+      uint32_t id;
+      if (!take(&pos, end, &id) || id != strings_.size()) {
+        error_ = "invalid string definition";
+        return false;
+      }
+      strings_.push_back(std::string(pos, end));
+      continue;
+    }
+    record->kind = static_cast<RecordKind>(kind);
+    record->extraNewline = flags & kExtraNewline;
+    const int count = fieldCount(record->kind);
+    if (count == 0) {
+      error_ = "unknown record kind";
+      return false;
+    }
+    for (int i = 0; i < count; ++i) {
+      if (!readValue(&pos, end, &record->fields[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+bool Reader::readValue(const char **pos, const char *end, Value *value) {
+  uint8_t type = kNil;
+  bool ok = take(pos, end, &type);
+  value->type = type;
+  value->str.clear();
+  if (ok) {
+    switch (type) {
+      case kNil:
+        break;
+      case kBoolean: {
+        uint8_t flag = 0;
+        ok = take(pos, end, &flag);
+        value->number = flag;
+        break;
+      }
+      case kInteger: {
+        int32_t number = 0;
+        ok = take(pos, end, &number);
+        value->number = number;
+        break;
+      }
+      case kNumber:
+        ok = take(pos, end, &value->number);
+        break;
+      case kString: {
+        uint32_t size = 0;
+        ok = take(pos, end, &size) && end - *pos >= static_cast<ptrdiff_t>(size);
+        if (ok) {
+          value->str.assign(*pos, size);
+          *pos += size;
+        }
+        break;
+      }
+      case kStringRef: {
+        uint32_t id = 0;
+        ok = take(pos, end, &id) && id < strings_.size();
+        if (ok) {
+          value->type = kString;
+          value->str = strings_[id];
+        }
+        break;
+      }
+      default:
+        ok = false;
+    }
+  }
+  if (!ok) {
+    error_ = "invalid record field";
+  }
+  return ok;
+}
+
+}  // namespace atf_trace
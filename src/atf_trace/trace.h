@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Binary trace of ATF log records.
+//
+// File starts with a header: "ATFTRACE" magic, uint32 version, int64 wall clock
+// and int64 monotonic clock of trace start in ns. The header is followed by records:
+// uint32 size of the rest of the record, uint8 kind, uint8 flags, int64 monotonic time
+// in ns and record fields. A field is uint8 value type and type specific data:
+// nothing for nil, uint8 for boolean, int32 for integer, double for number,
+// uint32 size and bytes for string, uint32 id for string reference.
+// Repeated strings (directions, function names) are defined once by kStringDef record
+// (uint32 id and bytes) and referenced by id afterwards.
+// All numbers are stored in host (little endian) byte order.
+namespace atf_trace {
+
+enum ValueType {
+  kNil = 0,
+  kBoolean = 1,
+  kInteger = 2,
+  kNumber = 3,
+  kString = 4,
+  kStringRef = 5
+};
+
+enum RecordKind {
+  kText = 0,    // Test step or summary line: text
+  kMobile = 1,  // direction, function name, 8 protocol header fields, payload
+  kHmi = 2,     // direction, message
+  kStringDef = 3
+};
+
+const int kMaxFields = 11;
+const uint32_t kVersion = 1;
+
+// Value of a record field, converted to text the same way Lua tostring() does
+struct Value {
+  int type;
+  double number;
+  std::string str;
+};
+
+struct Record {
+  RecordKind kind;
+  bool extraNewline;  // HMI message is followed by an empty line
+  int64_t time;       // Monotonic clock, ns
+  Value fields[kMaxFields];
+};
+
+int fieldCount(RecordKind kind);
+int64_t wallClock();
+int64_t monotonicClock();
+
+// Formats record the way ATF text logs do, time is wall clock in ns
+void formatText(const Record &record, int64_t time, std::string *out);
+
+class Writer {
+ public:
+  // Writes trace header, clocks are the base of record times
+  Writer(FILE *file, int64_t wallTime, int64_t monotonicTime);
+  bool write(const Record &record);
+ private:
+  void beginRecord(RecordKind kind, bool extraNewline, int64_t time);
+  bool endRecord();
+  void writeValue(const Value &value, bool intern);
+  uint32_t internString(const std::string &str);
+
+  FILE *file_;
+  std::string record_;
+  std::string pending_;  // String definitions preceding the record
+  std::unordered_map<std::string, uint32_t> strings_;
+};
+
+class Reader {
+ public:
+  explicit Reader(FILE *file);
+  // Returns false if the file is not an ATF trace
+  bool readHeader();
+  // Returns false at the end of file or on error
+  bool next(Record *record);
+  // Error description, empty if the trace was read completely
+  const std::string &error() const { return error_; }
+  // Converts monotonic record time to wall clock
+  int64_t wallTime(int64_t time) const { return wallTime_ + (time - monotonicTime_); }
+ private:
+  bool readValue(const char **pos, const char *end, Value *value);
+
+  FILE *file_;
+  int64_t wallTime_;
+  int64_t monotonicTime_;
+  std::string record_;
+  std::vector<std::string> strings_;
+  std::string error_;
+};
+
+}  // namespace atf_trace
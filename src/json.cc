@@ -0,0 +1,876 @@
+#include "json.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+const int kMaxDepth = 1000;
+const size_t kMaxNumberLength = 63;
+
+// json.null is a light C function returning itself, so it compares equal to
+// every value obtained through json.null or json.null() as in json4lua.
+int json_null(lua_State *L) {
+  lua_pushcfunction(L, &json_null);
+  return 1;
+}
+
+bool is_null(lua_State *L, int idx) {
+  return lua_iscfunction(L, idx) && lua_tocfunction(L, idx) == &json_null;
+}
+
+bool is_encodable(lua_State *L, int idx) {
+  switch (lua_type(L, idx)) {
+    case LUA_TNIL:
+    case LUA_TBOOLEAN:
+    case LUA_TNUMBER:
+    case LUA_TSTRING:
+    case LUA_TTABLE:
+      return true;
+    default:
+      return is_null(L, idx);
+  }
+}
+
+// Returns the array length for tables encoded as arrays, -1 for objects.
+// The json.EMPTY_ARRAY and json.EMPTY_OBJECT sentinels are expected as
+// upvalues 1 and 2 of the running C function.
+lua_Integer array_length(lua_State *L, int idx) {
+  if (lua_rawequal(L, idx, lua_upvalueindex(1))) {
+    return 0;
+  }
+  if (lua_rawequal(L, idx, lua_upvalueindex(2))) {
+    return -1;
+  }
+  lua_Number maxIndex = 0;
+  lua_pushnil(L);
+  while (lua_next(L, idx)) {
+    bool isArray = true;
+    if (lua_type(L, -2) == LUA_TNUMBER) {
+      const lua_Number key = lua_tonumberx(L, -2, NULL);
+      if (key >= 1 && std::floor(key) == key) {
+        isArray = is_encodable(L, -1);
+        if (key > maxIndex) {
+          maxIndex = key;
+        }
+      } else {
+        isArray = !is_encodable(L, -1);
+      }
+    } else if (lua_type(L, -2) == LUA_TSTRING && strcmp(lua_tostring(L, -2), "n") == 0) {
+      // json4lua tolerates 'n' holding the element count
+      isArray = !(lua_isboolean(L, -1) && !lua_toboolean(L, -1));
+    } else {
+      isArray = !is_encodable(L, -1);
+    }
+    lua_pop(L, 1);
+    if (!isArray) {
+      lua_pop(L, 1);
+      return -1;
+    }
+  }
+  return static_cast<lua_Integer>(maxIndex);
+}
+
+// Recursive descent decoder building Lua values directly from the source text.
+// Errors are raised with luaL_error, so nothing here may own C++ resources.
+class Decoder {
+ public:
+  Decoder(lua_State *L, const char *data, size_t size, size_t start)
+    : L_(L), begin_(data), p_(data + start), end_(data + size), depth_(0) { }
+
+  size_t position() const { return p_ - begin_; }
+
+  // Pushes exactly one value onto the stack, nil for JSON null.
+  void parseValue() {
+    skipWhitespace();
+    if (p_ >= end_) {
+      fail("Unterminated JSON encoded object found");
+    }
+    switch (*p_) {
+      case '{': parseObject(); break;
+      case '[': parseArray(); break;
+      case '"':
+      case '\'': parseString(); break;
+      case 't': parseConstant("true", 4); lua_pushboolean(L_, 1); break;
+      case 'f': parseConstant("false", 5); lua_pushboolean(L_, 0); break;
+      case 'n': parseConstant("null", 4); lua_pushnil(L_); break;
+      default:
+        if (strchr("+-0123456789.", *p_)) {
+          parseNumber();
+        } else {
+          fail("Unexpected character");
+        }
+    }
+  }
+
+  // Returns the first significant character or '\0' at the end of the text
+  char peek() {
+    skipWhitespace();
+    return p_ < end_ ? *p_ : '\0';
+  }
+
+  // Positions the decoder at the value of the top-level object member named key
+  // without building the values of the members skipped on the way.
+  // Returns false if the text is not an object or has no such member.
+  bool seekMember(const char *key, size_t len) {
+    if (peek() != '{') {
+      return false;
+    }
+    ++p_;
+    for (;;) {
+      skipWhitespace();
+      if (p_ >= end_) {
+        fail("Unterminated JSON object");
+      }
+      if (*p_ == '}') {
+        return false;
+      }
+      const bool found = matchKey(key, len);
+      skipWhitespace();
+      if (p_ >= end_ || *p_ != ':') {
+        fail("Expected ':' in JSON object");
+      }
+      ++p_;
+      if (found) {
+        skipWhitespace();
+        return true;
+      }
+      skipValue();
+      skipWhitespace();
+      if (p_ < end_ && *p_ == ',') {
+        ++p_;
+      } else if (p_ >= end_ || *p_ != '}') {
+        fail("Expected ',' or '}' in JSON object");
+      }
+    }
+  }
+
+ private:
+  bool matchKey(const char *key, size_t len) {
+    if (*p_ == '"' || *p_ == '\'') {
+      const char quote = *p_;
+      const char *start = p_ + 1;
+      const char *c = start;
+      while (c < end_ && *c != quote && *c != '\\') {
+        ++c;
+      }
+      if (c < end_ && *c == quote) {
+        p_ = c + 1;
+        return static_cast<size_t>(c - start) == len && memcmp(start, key, len) == 0;
+      }
+    }
+    // Escaped or non-string key
+    parseValue();
+    size_t keyLen;
+    const char *parsed = lua_type(L_, -1) == LUA_TSTRING ? lua_tolstring(L_, -1, &keyLen) : NULL;
+    const bool found = parsed && keyLen == len && memcmp(parsed, key, len) == 0;
+    lua_pop(L_, 1);
+    return found;
+  }
+
+  void skipString() {
+    const char quote = *p_++;
+    while (p_ < end_ && *p_ != quote) {
+      p_ += (*p_ == '\\') ? 2 : 1;
+    }
+    if (p_ >= end_) {
+      fail("Unterminated string");
+    }
+    ++p_;
+  }
+
+  void skipValue() {
+    const char c = peek();
+    if (c == '{' || c == '[') {
+      int depth = 0;
+      do {
+        if (p_ >= end_) {
+          fail("Unterminated JSON value");
+        }
+        if (*p_ == '"' || *p_ == '\'') {
+          skipString();
+          continue;
+        }
+        if (*p_ == '{' || *p_ == '[') {
+          ++depth;
+        } else if (*p_ == '}' || *p_ == ']') {
+          --depth;
+        }
+        ++p_;
+      } while (depth > 0);
+    } else if (c == '"' || c == '\'') {
+      skipString();
+    } else {
+      parseValue();
+      lua_pop(L_, 1);
+    }
+  }
+
+  void fail(const char *reason) {
+    luaL_error(L_, "json.decode: %s at position %d", reason, static_cast<int>(position()) + 1);
+  }
+
+  void skipWhitespace() {
+    for (;;) {
+      while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+        ++p_;
+      }
+      if (end_ - p_ < 2 || p_[0] != '/' || p_[1] != '*') {
+        return;
+      }
+      const char *close = NULL;
+      for (const char *c = p_ + 2; c + 1 < end_; ++c) {
+        if (c[0] == '*' && c[1] == '/') {
+          close = c;
+          break;
+        }
+      }
+      if (!close) {
+        fail("Unterminated comment");
+      }
+      p_ = close + 2;
+    }
+  }
+
+  void enter() {
+    if (++depth_ > kMaxDepth) {
+      fail("Nesting too deep");
+    }
+    luaL_checkstack(L_, 4, "json.decode: nesting too deep");
+  }
+
+  void parseObject() {
+    enter();
+    ++p_;
+    lua_newtable(L_);
+    for (;;) {
+      skipWhitespace();
+      if (p_ >= end_) {
+        fail("Unterminated JSON object");
+      }
+      if (*p_ == '}') {
+        ++p_;
+        break;
+      }
+      parseValue();
+      if (lua_isnil(L_, -1)) {
+        fail("Object key must not be null");
+      }
+      skipWhitespace();
+      if (p_ >= end_ || *p_ != ':') {
+        fail("Expected ':' in JSON object");
+      }
+      ++p_;
+      parseValue();
+      lua_rawset(L_, -3);
+      skipWhitespace();
+      if (p_ < end_ && *p_ == ',') {
+        ++p_;
+      } else if (p_ >= end_ || *p_ != '}') {
+        fail("Expected ',' or '}' in JSON object");
+      }
+    }
+    --depth_;
+  }
+
+  void parseArray() {
+    enter();
+    ++p_;
+    lua_newtable(L_);
+    int index = 1;
+    for (;;) {
+      skipWhitespace();
+      if (p_ >= end_) {
+        fail("Unterminated JSON array");
+      }
+      if (*p_ == ']') {
+        ++p_;
+        break;
+      }
+      parseValue();
+      lua_rawseti(L_, -2, index++);
+      skipWhitespace();
+      if (p_ < end_ && *p_ == ',') {
+        ++p_;
+      } else if (p_ >= end_ || *p_ != ']') {
+        fail("Expected ',' or ']' in JSON array");
+      }
+    }
+    --depth_;
+  }
+
+  void parseConstant(const char *name, size_t len) {
+    if (static_cast<size_t>(end_ - p_) < len || memcmp(p_, name, len) != 0) {
+      fail("Failed to scan constant");
+    }
+    p_ += len;
+  }
+
+  void parseNumber() {
+    const char *start = p_;
+    while (p_ < end_ && strchr("+-0123456789.eE", *p_)) {
+      ++p_;
+    }
+    const size_t len = p_ - start;
+    char number[kMaxNumberLength + 1];
+    if (len > kMaxNumberLength) {
+      fail("Failed to scan number");
+    }
+    memcpy(number, start, len);
+    number[len] = '\0';
+    char *parsed = NULL;
+    const lua_Number value = strtod(number, &parsed);
+    if (parsed != number + len) {
+      fail("Failed to scan number");
+    }
+    lua_pushnumber(L_, value);
+  }
+
+  int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    fail("Invalid unicode escape");
+    return 0;
+  }
+
+  // Reads XXXX of a \uXXXX sequence, p_ pointing right after 'u'
+  unsigned readHex4() {
+    if (end_ - p_ < 4) {
+      fail("Invalid unicode escape");
+    }
+    unsigned code = 0;
+    for (int i = 0; i < 4; ++i) {
+      code = (code << 4) | hexValue(*p_++);
+    }
+    return code;
+  }
+
+  void addUtf8(luaL_Buffer *b, unsigned code) {
+    char out[4];
+    size_t len;
+    if (code < 0x80) {
+      out[0] = static_cast<char>(code);
+      len = 1;
+    } else if (code < 0x800) {
+      out[0] = static_cast<char>(0xC0 | (code >> 6));
+      out[1] = static_cast<char>(0x80 | (code & 0x3F));
+      len = 2;
+    } else if (code < 0x10000) {
+      out[0] = static_cast<char>(0xE0 | (code >> 12));
+      out[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out[2] = static_cast<char>(0x80 | (code & 0x3F));
+      len = 3;
+    } else {
+      out[0] = static_cast<char>(0xF0 | (code >> 18));
+      out[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+      out[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out[3] = static_cast<char>(0x80 | (code & 0x3F));
+      len = 4;
+    }
+    luaL_addlstring(b, out, len);
+  }
+
+  void parseString() {
+    const char quote = *p_++;
+    const char *start = p_;
+    while (p_ < end_ && *p_ != quote && *p_ != '\\') {
+      ++p_;
+    }
+    if (p_ >= end_) {
+      fail("Unterminated string");
+    }
+    if (*p_ == quote) {
+      lua_pushlstring(L_, start, p_ - start);
+      ++p_;
+      return;
+    }
+
+    luaL_Buffer b;
+    luaL_buffinit(L_, &b);
+    luaL_addlstring(&b, start, p_ - start);
+    for (;;) {
+      if (p_ >= end_) {
+        fail("Unterminated string");
+      }
+      const char c = *p_++;
+      if (c == quote) {
+        break;
+      }
+      if (c != '\\') {
+        luaL_addchar(&b, c);
+        continue;
+      }
+      if (p_ >= end_) {
+        fail("Unterminated string");
+      }
+      const char escaped = *p_++;
+      switch (escaped) {
+        case 'b': luaL_addchar(&b, '\b'); break;
+        case 'f': luaL_addchar(&b, '\f'); break;
+        case 'n': luaL_addchar(&b, '\n'); break;
+        case 'r': luaL_addchar(&b, '\r'); break;
+        case 't': luaL_addchar(&b, '\t'); break;
+        case 'u': {
+          unsigned code = readHex4();
+          if (code >= 0xD800 && code <= 0xDBFF && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+            const char *saved = p_;
+            p_ += 2;
+            const unsigned low = readHex4();
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+              code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            } else {
+              p_ = saved;
+            }
+          }
+          addUtf8(&b, code);
+          break;
+        }
+        default:
+          // \" \\ \/ and any other escaped character stand for themselves
+          luaL_addchar(&b, escaped);
+      }
+    }
+    luaL_pushresult(&b);
+  }
+
+  lua_State *L_;
+  const char *begin_;
+  const char *p_;
+  const char *end_;
+  int depth_;
+};
+
+// Lazy payloads are empty proxy tables with the "json.Lazy" metatable.
+// The raw JSON text of a proxy is kept in a weak keyed registry table.
+// Scalar members are decoded and cached one by one on read; any other access
+// decodes the whole text into the proxy and drops the metatable, so from then
+// on it is an ordinary table.
+const char *kLazyMetatable = "json.Lazy";
+const char *kLazyTexts = "json.LazyTexts";
+
+// Pushes the raw text of a lazy proxy, returns false (pushing nothing) for other values
+bool push_lazy_text(lua_State *L, int idx) {
+  if (!lua_getmetatable(L, idx)) {
+    return false;
+  }
+  luaL_getmetatable(L, kLazyMetatable);
+  const bool isLazy = lua_rawequal(L, -1, -2);
+  lua_pop(L, 2);
+  if (!isLazy) {
+    return false;
+  }
+  lua_getfield(L, LUA_REGISTRYINDEX, kLazyTexts);
+  lua_pushvalue(L, idx);
+  lua_rawget(L, -2);
+  lua_remove(L, -2);
+  return true;
+}
+
+void lazy_materialize(lua_State *L, int idx) {
+  if (!push_lazy_text(L, idx)) {
+    return;
+  }
+  size_t size;
+  const char *text = lua_tolstring(L, -1, &size);
+  Decoder decoder(L, text, size, 0);
+  decoder.parseValue();
+  lua_pushnil(L);
+  while (lua_next(L, -2)) {
+    // Members cached on read are kept as they are
+    lua_pushvalue(L, -2);
+    lua_rawget(L, idx);
+    const bool cached = !lua_isnil(L, -1);
+    lua_pop(L, 1);
+    if (!cached) {
+      lua_pushvalue(L, -2);
+      lua_pushvalue(L, -2);
+      lua_rawset(L, idx);
+    }
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 2);
+
+  lua_pushnil(L);
+  lua_setmetatable(L, idx);
+  lua_getfield(L, LUA_REGISTRYINDEX, kLazyTexts);
+  lua_pushvalue(L, idx);
+  lua_pushnil(L);
+  lua_rawset(L, -3);
+  lua_pop(L, 1);
+}
+
+int lazy_index(lua_State *L) {
+  if (lua_type(L, 2) == LUA_TSTRING && push_lazy_text(L, 1)) {
+    size_t size, keyLen;
+    const char *text = lua_tolstring(L, -1, &size);
+    const char *key = lua_tolstring(L, 2, &keyLen);
+    Decoder decoder(L, text, size, 0);
+    if (!decoder.seekMember(key, keyLen)) {
+      lua_pushnil(L);
+      return 1;
+    }
+    const char c = decoder.peek();
+    if (c != '{' && c != '[') {
+      decoder.parseValue();
+      lua_pushvalue(L, 2);
+      lua_pushvalue(L, -2);
+      lua_rawset(L, 1);
+      return 1;
+    }
+    // Nested tables may be modified by the caller, so the proxy is materialized
+    // to keep the raw text from diverging from the content
+    lua_pop(L, 1);
+  }
+  lazy_materialize(L, 1);
+  lua_settop(L, 2);
+  lua_rawget(L, 1);
+  return 1;
+}
+
+int lazy_newindex(lua_State *L) {
+  lazy_materialize(L, 1);
+  lua_settop(L, 3);
+  lua_rawset(L, 1);
+  return 0;
+}
+
+int lazy_len(lua_State *L) {
+  if (push_lazy_text(L, 1)) {
+    size_t size;
+    const char *text = lua_tolstring(L, -1, &size);
+    // A decoded JSON object has no array part
+    if (Decoder(L, text, size, 0).peek() == '{') {
+      lua_pushinteger(L, 0);
+      return 1;
+    }
+    lua_pop(L, 1);
+  }
+  lazy_materialize(L, 1);
+  lua_pushinteger(L, lua_rawlen(L, 1));
+  return 1;
+}
+
+int lazy_next(lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_settop(L, 2);
+  if (lua_next(L, 1)) {
+    return 2;
+  }
+  lua_pushnil(L);
+  return 1;
+}
+
+int lazy_pairs(lua_State *L) {
+  lazy_materialize(L, 1);
+  lua_pushcfunction(L, &lazy_next);
+  lua_pushvalue(L, 1);
+  lua_pushnil(L);
+  return 3;
+}
+
+int lazy_inext(lua_State *L) {
+  const lua_Integer i = luaL_checkinteger(L, 2) + 1;
+  lua_pushinteger(L, i);
+  lua_rawgeti(L, 1, static_cast<int>(i));
+  return lua_isnil(L, -1) ? 1 : 2;
+}
+
+int lazy_ipairs(lua_State *L) {
+  lazy_materialize(L, 1);
+  lua_pushcfunction(L, &lazy_inext);
+  lua_pushvalue(L, 1);
+  lua_pushinteger(L, 0);
+  return 3;
+}
+
+// Serializes Lua values following json4lua rules:
+// a table is an array if all its encodable values have positive integer keys
+// (an empty table is an array too), json.EMPTY_ARRAY and json.EMPTY_OBJECT
+// force the respective representation, unencodable object members are skipped.
+class Encoder {
+ public:
+  explicit Encoder(lua_State *L) : L_(L), depth_(0) {
+    out_.reserve(256);
+  }
+
+  const std::string &result() const { return out_; }
+  const std::string &error() const { return error_; }
+
+  bool encode(int idx) {
+    switch (lua_type(L_, idx)) {
+      case LUA_TNIL:
+        out_.append("null", 4);
+        return true;
+      case LUA_TBOOLEAN:
+        if (lua_toboolean(L_, idx)) {
+          out_.append("true", 4);
+        } else {
+          out_.append("false", 5);
+        }
+        return true;
+      case LUA_TNUMBER:
+        appendNumber(lua_tonumberx(L_, idx, NULL));
+        return true;
+      case LUA_TSTRING: {
+        size_t len;
+        const char *s = lua_tolstring(L_, idx, &len);
+        appendString(s, len);
+        return true;
+      }
+      case LUA_TTABLE:
+        if (push_lazy_text(L_, idx)) {
+          // Not yet materialized payloads are written as received
+          size_t len;
+          const char *text = lua_tolstring(L_, -1, &len);
+          out_.append(text, len);
+          lua_pop(L_, 1);
+          return true;
+        }
+        return encodeTable(lua_absindex(L_, idx));
+      default:
+        if (is_null(L_, idx)) {
+          out_.append("null", 4);
+          return true;
+        }
+        lua_pushvalue(L_, idx);
+        error_ = std::string("encode attempt to operate on type ") + luaL_typename(L_, idx)
+          + " with value " + luaL_tolstring(L_, -1, NULL);
+        lua_pop(L_, 2);
+        return false;
+    }
+  }
+
+ private:
+  bool encodeTable(int idx) {
+    if (depth_ >= kMaxDepth || !lua_checkstack(L_, 4)) {
+      error_ = "encode: table nesting too deep (cyclic reference?)";
+      return false;
+    }
+    ++depth_;
+    const lua_Integer length = array_length(L_, idx);
+    if (length >= 0) {
+      out_.push_back('[');
+      for (lua_Integer i = 1; i <= length; ++i) {
+        if (i > 1) {
+          out_.push_back(',');
+        }
+        lua_rawgeti(L_, idx, static_cast<int>(i));
+        const bool ok = encode(lua_gettop(L_));
+        lua_pop(L_, 1);
+        if (!ok) {
+          return false;
+        }
+      }
+      out_.push_back(']');
+    } else {
+      out_.push_back('{');
+      bool first = true;
+      lua_pushnil(L_);
+      while (lua_next(L_, idx)) {
+        if (is_encodable(L_, -2) && is_encodable(L_, -1)) {
+          if (!first) {
+            out_.push_back(',');
+          }
+          first = false;
+          appendKey(-2);
+          out_.push_back(':');
+          if (!encode(lua_gettop(L_))) {
+            lua_pop(L_, 2);
+            return false;
+          }
+        }
+        lua_pop(L_, 1);
+      }
+      out_.push_back('}');
+    }
+    --depth_;
+    return true;
+  }
+
+  // Keys are always written as strings, converted the way tostring() does.
+  // Numbers are formatted here because lua_tolstring would convert the key in place.
+  void appendKey(int idx) {
+    switch (lua_type(L_, idx)) {
+      case LUA_TSTRING: {
+        size_t len;
+        const char *s = lua_tolstring(L_, idx, &len);
+        appendString(s, len);
+        break;
+      }
+      case LUA_TNUMBER: {
+        out_.push_back('"');
+        appendNumber(lua_tonumberx(L_, idx, NULL));
+        out_.push_back('"');
+        break;
+      }
+      default: {
+        size_t len;
+        lua_pushvalue(L_, idx);
+        const char *s = luaL_tolstring(L_, -1, &len);
+        appendString(s, len);
+        lua_pop(L_, 2);
+      }
+    }
+  }
+
+  void appendNumber(lua_Number value) {
+    char buffer[64];
+    const int len = snprintf(buffer, sizeof(buffer), LUA_NUMBER_FMT, value);
+    out_.append(buffer, len);
+  }
+
+  void appendString(const char *s, size_t len) {
+    out_.push_back('"');
+    const char *run = s;
+    for (const char *c = s; c < s + len; ++c) {
+      const char *escaped = NULL;
+      switch (*c) {
+        case '"': escaped = "\\\""; break;
+        case '\\': escaped = "\\\\"; break;
+        case '/': escaped = "\\/"; break;
+        case '\b': escaped = "\\b"; break;
+        case '\f': escaped = "\\f"; break;
+        case '\n': escaped = "\\n"; break;
+        case '\r': escaped = "\\r"; break;
+        case '\t': escaped = "\\t"; break;
+        default: continue;
+      }
+      out_.append(run, c - run);
+      out_.append(escaped, 2);
+      run = c + 1;
+    }
+    out_.append(run, s + len - run);
+    out_.push_back('"');
+  }
+
+  lua_State *L_;
+  int depth_;
+  std::string out_;
+  std::string error_;
+};
+
+// json.encode(value)
+// Returns JSON text for value, raises an error for values JSON can't represent.
+int json_encode(lua_State *L) {
+  lua_settop(L, 1);
+  bool ok;
+  {
+    Encoder encoder(L);
+    ok = encoder.encode(1);
+    if (ok) {
+      lua_pushlstring(L, encoder.result().data(), encoder.result().size());
+    } else {
+      lua_pushstring(L, encoder.error().c_str());
+    }
+  }
+  if (!ok) {
+    return lua_error(L);
+  }
+  return 1;
+}
+
+// json.isArray(value)
+// Returns true and the array length if value would be encoded as a JSON array.
+int json_is_array(lua_State *L) {
+  if (!lua_istable(L, 1)) {
+    lua_pushboolean(L, 0);
+    return 1;
+  }
+  lazy_materialize(L, 1);
+  const lua_Integer length = array_length(L, 1);
+  if (length < 0) {
+    lua_pushboolean(L, 0);
+    return 1;
+  }
+  lua_pushboolean(L, 1);
+  lua_pushinteger(L, length);
+  return 2;
+}
+
+// json.decode(text[, startPos])
+// Returns the decoded value and the position right after it in text.
+// JSON null is decoded to nil.
+int json_decode(lua_State *L) {
+  size_t size;
+  const char *text = luaL_checklstring(L, 1, &size);
+  const lua_Integer startPos = luaL_optinteger(L, 2, 1);
+  luaL_argcheck(L, startPos >= 1 && static_cast<size_t>(startPos) <= size + 1, 2, "out of range");
+  Decoder decoder(L, text, size, startPos - 1);
+  decoder.parseValue();
+  lua_pushinteger(L, decoder.position() + 1);
+  return 2;
+}
+
+// json.lazy(text)
+// Returns a proxy table decoding the JSON object or array in text on demand.
+// Other JSON values are decoded immediately.
+int json_lazy(lua_State *L) {
+  size_t size;
+  const char *text = luaL_checklstring(L, 1, &size);
+  const char c = Decoder(L, text, size, 0).peek();
+  if (c != '{' && c != '[') {
+    Decoder decoder(L, text, size, 0);
+    decoder.parseValue();
+    return 1;
+  }
+  lua_newtable(L);
+  luaL_setmetatable(L, kLazyMetatable);
+  lua_getfield(L, LUA_REGISTRYINDEX, kLazyTexts);
+  lua_pushvalue(L, -2);
+  lua_pushvalue(L, 1);
+  lua_rawset(L, -3);
+  lua_pop(L, 1);
+  return 1;
+}
+}  // anonymous namespace
+
+int luaopen_json(lua_State *L) {
+  luaL_newmetatable(L, kLazyMetatable);
+  luaL_Reg lazy_functions[] = {
+    { "__index", &lazy_index },
+    { "__newindex", &lazy_newindex },
+    { "__len", &lazy_len },
+    { "__pairs", &lazy_pairs },
+    { "__ipairs", &lazy_ipairs },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, lazy_functions, 0);
+  lua_pop(L, 1);
+
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_pushliteral(L, "k");
+  lua_setfield(L, -2, "__mode");
+  lua_setmetatable(L, -2);
+  lua_setfield(L, LUA_REGISTRYINDEX, kLazyTexts);
+
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_pushvalue(L, -1);
+  lua_setfield(L, -3, "EMPTY_ARRAY");
+  lua_newtable(L);
+  lua_pushvalue(L, -1);
+  lua_setfield(L, -4, "EMPTY_OBJECT");
+  luaL_Reg encode_functions[] = {
+    { "encode", &json_encode },
+    { "isArray", &json_is_array },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, encode_functions, 2);
+
+  luaL_Reg json_functions[] = {
+    { "decode", &json_decode },
+    { "lazy", &json_lazy },
+    { "null", &json_null },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, json_functions, 0);
+  return 1;
+}
+
+void json_materialize(lua_State *L, int idx) {
+  lazy_materialize(L, lua_absindex(L, idx));
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+int luaopen_json(lua_State *L);
+
+// Decodes a lazy payload (see json.lazy) at idx into an ordinary table in place.
+// Other values are left untouched.
+void json_materialize(lua_State *L, int idx);
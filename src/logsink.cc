@@ -0,0 +1,432 @@
+#include "logsink.h"
+#include "atf_trace/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+const size_t kRingCapacity = 4096;
+const int kMainLog = 1;
+const int kFullLog = 2;
+
+// Tracts of logged messages, indexes of LogLevels::directions
+enum Direction { kMobToSdl, kSdlToMob, kHmiToSdl, kSdlToHmi, kDirectionCount };
+const char *kDirectionNames[] = { "MOBtoSDL", "SDLtoMOB", "HMItoSDL", "SDLtoHMI", NULL };
+
+// Log levels, record of a level is written to the logs up to it
+enum Level { kLevelNone, kLevelNormal, kLevelFull };
+const char *kLevelNames[] = { "none", "normal", "full", NULL };
+
+const int kControlFrame = 0x00;
+const int kHeartbeat = 0x00;
+const int kHeartbeatAck = 0xFF;
+const int kServicePcm = 0x0A;
+const int kServiceVideo = 0x0B;
+
+// Used by the interpreter thread only, to decide on a record before it is built
+struct LogLevels {
+  LogLevels() : heartbeat(kLevelFull) {
+    std::fill(directions, directions + kDirectionCount, kLevelFull);
+    std::fill(services, services + 256, kLevelFull);
+  }
+  Level directions[kDirectionCount];
+  Level services[256];
+  Level heartbeat;
+};
+
+struct Entry {
+  int targets;
+  atf_trace::Record record;
+};
+
+// Single producer (interpreter thread), single consumer (writer thread) ring of records.
+// Slots are reused, so strings of a warmed up ring don't allocate memory.
+class LogSink {
+ public:
+  // Full log is written as binary trace if fullTrace is set
+  LogSink(FILE *mainLog, FILE *fullLog, bool fullTrace);
+  ~LogSink();
+  Entry &acquire();
+  void commit();
+  // Waits until all committed records are written and flushed
+  void flush();
+  void close();
+  bool hasFullLog() const { return fullLog_ != NULL; }
+  LogLevels &levels() { return levels_; }
+ private:
+  void run();
+  void wake();
+
+  FILE *mainLog_;
+  FILE *fullLog_;
+  const int64_t wallTime_;
+  const int64_t monotonicTime_;
+  atf_trace::Writer *trace_;
+  std::vector<Entry> slots_;
+  std::atomic<size_t> head_;     // Next record to write, owned by the writer
+  std::atomic<size_t> tail_;     // Next free slot, owned by the interpreter
+  std::atomic<size_t> written_;  // Records written and flushed to files
+  std::atomic<bool> sleeping_;
+  std::atomic<bool> stop_;
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::thread thread_;
+  LogLevels levels_;
+};
+
+LogSink::LogSink(FILE *mainLog, FILE *fullLog, bool fullTrace)
+  : mainLog_(mainLog), fullLog_(fullLog),
+    wallTime_(atf_trace::wallClock()), monotonicTime_(atf_trace::monotonicClock()),
+    trace_(fullTrace && fullLog ? new atf_trace::Writer(fullLog, wallTime_, monotonicTime_) : NULL),
+    slots_(kRingCapacity), head_(0), tail_(0), written_(0), sleeping_(false), stop_(false),
+    thread_(&LogSink::run, this) { }
+
+LogSink::~LogSink() {
+  close();
+}
+
+Entry &LogSink::acquire() {
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  // Records are never dropped: the interpreter waits for the writer if the ring is full
+  while (tail - head_.load(std::memory_order_acquire) == kRingCapacity) {
+    wake();
+    std::this_thread::yield();
+  }
+  Entry &entry = slots_[tail % kRingCapacity];
+  entry.record.time = atf_trace::monotonicClock();
+  entry.record.extraNewline = false;
+  return entry;
+}
+
+void LogSink::commit() {
+  tail_.store(tail_.load(std::memory_order_relaxed) + 1);
+  if (sleeping_.load()) {
+    wake();
+  }
+}
+
+void LogSink::wake() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  wakeup_.notify_one();
+}
+
+void LogSink::flush() {
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  while (thread_.joinable() && written_.load(std::memory_order_acquire) < tail) {
+    wake();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void LogSink::close() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_.store(true);
+  wake();
+  thread_.join();
+  delete trace_;
+  trace_ = NULL;
+  if (mainLog_) fclose(mainLog_);
+  if (fullLog_) fclose(fullLog_);
+  mainLog_ = fullLog_ = NULL;
+}
+
+void LogSink::run() {
+  std::string line;
+  bool dirty = false;
+  while (true) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    if (head == tail) {
+      // Files are flushed once the ring is drained, so a burst costs one flush
+      if (dirty) {
+        if (mainLog_) fflush(mainLog_);
+        if (fullLog_) fflush(fullLog_);
+        written_.store(head, std::memory_order_release);
+        dirty = false;
+      }
+      if (stop_.load()) {
+        break;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      sleeping_.store(true);
+      wakeup_.wait_for(lock, std::chrono::milliseconds(100), [this] {
+        return stop_.load() || head_.load() != tail_.load();
+      });
+      sleeping_.store(false);
+      continue;
+    }
+    for (; head != tail; ++head) {
+      const Entry &entry = slots_[head % kRingCapacity];
+      const bool text = (entry.targets & kMainLog && mainLog_)
+          || (entry.targets & kFullLog && fullLog_ && !trace_);
+      if (text) {
+        const int64_t time = wallTime_ + (entry.record.time - monotonicTime_);
+        atf_trace::formatText(entry.record, time, &line);
+      }
+      if ((entry.targets & kMainLog) && mainLog_) {
+        fwrite(line.data(), 1, line.size(), mainLog_);
+      }
+      if ((entry.targets & kFullLog) && trace_) {
+        trace_->write(entry.record);
+      } else if ((entry.targets & kFullLog) && fullLog_) {
+        fwrite(line.data(), 1, line.size(), fullLog_);
+      }
+      head_.store(head + 1, std::memory_order_release);
+    }
+    dirty = true;
+  }
+}
+
+void store_field(lua_State *L, int idx, atf_trace::Value *field) {
+  switch (lua_type(L, idx)) {
+    case LUA_TNONE:
+    case LUA_TNIL:
+      field->type = atf_trace::kNil;
+      break;
+    case LUA_TBOOLEAN:
+      field->type = atf_trace::kBoolean;
+      field->number = lua_toboolean(L, idx);
+      break;
+    case LUA_TNUMBER:
+      field->type = atf_trace::kNumber;
+      field->number = lua_tonumber(L, idx);
+      break;
+    default: {
+      size_t size;
+      const char *str = luaL_tolstring(L, idx, &size);
+      field->type = atf_trace::kString;
+      field->str.assign(str, size);
+      lua_pop(L, 1);
+    }
+  }
+}
+
+LogSink *check_sink(lua_State *L) {
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "logsink.Sink"));
+  if (!sink) {
+    luaL_error(L, "logsink.Sink is closed");
+  }
+  return sink;
+}
+
+Level check_level(lua_State *L, int idx, const char *name) {
+  const char *level = lua_tostring(L, idx);
+  for (int i = 0; level && kLevelNames[i]; ++i) {
+    if (strcmp(level, kLevelNames[i]) == 0) {
+      return static_cast<Level>(i);
+    }
+  }
+  luaL_error(L, "set_levels: invalid level of %s", name);
+  return kLevelNone;
+}
+
+// Level of nil is full
+Level field_level(lua_State *L, int idx, const char *name) {
+  lua_getfield(L, idx, name);
+  const Level level = lua_isnil(L, -1) ? kLevelFull : check_level(L, -1, name);
+  lua_pop(L, 1);
+  return level;
+}
+
+int targets_of(LogSink *sink, Level level, bool normalLog) {
+  int targets = 0;
+  if (level >= kLevelNormal && normalLog) {
+    targets |= kMainLog;
+  }
+  if (level >= kLevelFull && sink->hasFullLog()) {
+    targets |= kFullLog;
+  }
+  return targets;
+}
+
+FILE *open_log(lua_State *L, int idx) {
+  if (lua_isnoneornil(L, idx)) {
+    return NULL;
+  }
+  const char *filename = luaL_checkstring(L, idx);
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    luaL_error(L, "logsink.open: %s: %s", filename, strerror(errno));
+  }
+  return file;
+}
+
+// logsink.open(filename[, full_filename[, full_format]])
+// Opens normal and optional full log files, records are addressed to them
+// with logsink.MAIN and logsink.FULL flags.
+// full_format is "text" (default) or "trace" for binary trace rendered by atf_trace tool
+int logsink_open(lua_State *L) {
+  static const char *formats[] = { "text", "trace", NULL };
+  const bool fullTrace = luaL_checkoption(L, 3, "text", formats) == 1;
+  FILE *mainLog = open_log(L, 1);
+  FILE *fullLog = open_log(L, 2);
+  LogSink **p = static_cast<LogSink**>(lua_newuserdata(L, sizeof(LogSink*)));
+  *p = new LogSink(mainLog, fullLog, fullTrace);
+  luaL_getmetatable(L, "logsink.Sink");
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+// sink:mobile(targets, direction, function_name, sessionId, version, frameType,
+//             encryption, serviceType, frameInfo, messageId, binaryDataSize, payload)
+int sink_mobile(lua_State *L) {
+  LogSink *sink = check_sink(L);
+  const int targets = luaL_checkinteger(L, 2);
+  Entry &entry = sink->acquire();
+  atf_trace::Record &record = entry.record;
+  entry.targets = targets;
+  record.kind = atf_trace::kMobile;
+  for (int i = 0; i < atf_trace::fieldCount(atf_trace::kMobile); ++i) {
+    store_field(L, i + 3, &record.fields[i]);
+  }
+  sink->commit();
+  return 0;
+}
+
+// sink:hmi(targets, direction, message[, extra_newline])
+int sink_hmi(lua_State *L) {
+  LogSink *sink = check_sink(L);
+  const int targets = luaL_checkinteger(L, 2);
+  Entry &entry = sink->acquire();
+  atf_trace::Record &record = entry.record;
+  entry.targets = targets;
+  record.kind = atf_trace::kHmi;
+  record.extraNewline = lua_toboolean(L, 5);
+  store_field(L, 3, &record.fields[0]);
+  store_field(L, 4, &record.fields[1]);
+  sink->commit();
+  return 0;
+}
+
+// sink:text(targets, text)
+int sink_text(lua_State *L) {
+  LogSink *sink = check_sink(L);
+  const int targets = luaL_checkinteger(L, 2);
+  luaL_checkstring(L, 3);
+  Entry &entry = sink->acquire();
+  atf_trace::Record &record = entry.record;
+  entry.targets = targets;
+  record.kind = atf_trace::kText;
+  store_field(L, 3, &record.fields[0]);
+  sink->commit();
+  return 0;
+}
+
+// sink:set_levels{MOBtoSDL = level, SDLtoMOB = level, HMItoSDL = level, SDLtoHMI = level,
+//                 heartbeat = level, services = {[serviceType] = level}}
+// Levels are "none", "normal" (normal log only) and "full" (normal and full logs), missing ones are "full".
+// Level of a mobile message is the lowest of its direction, service and heartbeat levels
+int sink_set_levels(lua_State *L) {
+  LogLevels &levels = check_sink(L)->levels();
+  luaL_checktype(L, 2, LUA_TTABLE);
+  LogLevels result;
+  for (int i = 0; i < kDirectionCount; ++i) {
+    result.directions[i] = field_level(L, 2, kDirectionNames[i]);
+  }
+  result.heartbeat = field_level(L, 2, "heartbeat");
+  lua_getfield(L, 2, "services");
+  if (!lua_isnil(L, -1)) {
+    luaL_checktype(L, -1, LUA_TTABLE);
+    lua_pushnil(L);
+    while (lua_next(L, -2)) {
+      const int service = lua_tointeger(L, -2);
+      if (!lua_isnumber(L, -2) || service < 0 || service > 255) {
+        return luaL_error(L, "set_levels: invalid service type");
+      }
+      result.services[service] = check_level(L, -1, "service");
+      lua_pop(L, 1);
+    }
+  }
+  lua_pop(L, 1);
+  levels = result;
+  return 0;
+}
+
+// sink:mobile_targets(tract, frameType, serviceType, frameInfo)
+// Returns log files (logsink.MAIN and logsink.FULL flags) a mobile message goes to, 0 if none
+int sink_mobile_targets(lua_State *L) {
+  LogSink *sink = check_sink(L);
+  const LogLevels &levels = sink->levels();
+  const int direction = luaL_checkoption(L, 2, NULL, kDirectionNames);
+  Level level = levels.directions[direction];
+  const bool hasFrameType = lua_isnumber(L, 3);
+  const int frameType = lua_tointeger(L, 3);
+  const int serviceType = lua_tointeger(L, 4);
+  const int frameInfo = lua_tointeger(L, 5);
+  if (lua_isnumber(L, 4) && serviceType >= 0 && serviceType <= 255) {
+    level = std::min(level, levels.services[serviceType]);
+  }
+  const bool control = hasFrameType && frameType == kControlFrame;
+  if (control && lua_isnumber(L, 5) && (frameInfo == kHeartbeat || frameInfo == kHeartbeatAck)) {
+    level = std::min(level, levels.heartbeat);
+  }
+  // Normal log keeps data frames except audio and video streaming
+  const bool normalLog = !control
+      && !(lua_isnumber(L, 4) && (serviceType == kServicePcm || serviceType == kServiceVideo));
+  lua_pushinteger(L, targets_of(sink, level, normalLog));
+  return 1;
+}
+
+// sink:hmi_targets(tract)
+int sink_hmi_targets(lua_State *L) {
+  LogSink *sink = check_sink(L);
+  const int direction = luaL_checkoption(L, 2, NULL, kDirectionNames);
+  lua_pushinteger(L, targets_of(sink, sink->levels().directions[direction], true));
+  return 1;
+}
+
+int sink_flush(lua_State *L) {
+  check_sink(L)->flush();
+  return 0;
+}
+
+int sink_close(lua_State *L) {
+  LogSink **p = static_cast<LogSink**>(luaL_checkudata(L, 1, "logsink.Sink"));
+  delete *p;
+  *p = NULL;
+  return 0;
+}
+}
+
+int luaopen_logsink(lua_State *L) {
+  luaL_newmetatable(L, "logsink.Sink");
+  lua_newtable(L);
+  luaL_Reg sink_functions[] = {
+    { "mobile", &sink_mobile },
+    { "hmi", &sink_hmi },
+    { "text", &sink_text },
+    { "set_levels", &sink_set_levels },
+    { "mobile_targets", &sink_mobile_targets },
+    { "hmi_targets", &sink_hmi_targets },
+    { "flush", &sink_flush },
+    { "close", &sink_close },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, sink_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, &sink_close);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+
+  luaL_Reg functions[] = {
+    { "open", &logsink_open },
+    { NULL, NULL }
+  };
+  luaL_newlib(L, functions);
+  lua_pushinteger(L, kMainLog);
+  lua_setfield(L, -2, "MAIN");
+  lua_pushinteger(L, kFullLog);
+  lua_setfield(L, -2, "FULL");
+  return 1;
+}
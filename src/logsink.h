@@ -0,0 +1,11 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+// Log sink formats and writes records on a background thread.
+// The interpreter thread only copies raw record fields into a ring buffer.
+int luaopen_logsink(lua_State *L);
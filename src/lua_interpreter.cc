@@ -9,6 +9,11 @@
 #include "timers.h"
 #include "qtlua.h"
 #include "qdatetime.h"
+#include "logsink.h"
+#include "protocol.h"
+#include "json.h"
+#include "api_schema.h"
+#include "process.h"
 #include <assert.h>
 #include <iostream>
 #include <stdexcept>
@@ -55,6 +60,61 @@ int arguments(lua_State *L) {
   }
   return 1;
 }
+
+// async(func, ...)
+// Runs func in a new coroutine which can suspend itself by await(), timers.sleepAsync()
+// or timers.waitFor().
+// Errors of the coroutine are reported to stderr. Returns the coroutine.
+int async_call(lua_State *L) {
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+  const int nargs = lua_gettop(L) - 1;
+  lua_State *thread = lua_newthread(L);
+  timers_mark_async(L, -1);
+  lua_insert(L, 1);
+  lua_xmove(L, thread, nargs + 1);
+  CoroutineWaker::resumeThread(thread, nargs);
+  return 1;
+}
+
+// Connects signal of the sender to a waker of the running coroutine.
+// Returns false if the Qt object has no such signal.
+// Kept apart from await_signal: lua_yield and luaL_error longjmp, so no C++ object
+// may be alive there.
+bool connect_waker(lua_State *L, QObject *sender, bool dynamic, const char *signal, int msec) {
+  const QByteArray signature = QMetaObject::normalizedSignature(signal);
+  if (dynamic) {
+    CoroutineWaker *waker = timers_create_waker(L, msec);
+    static_cast<DynamicObject*>(sender)->connectDynamicSignal(signature, waker, "wake()");
+    return true;
+  }
+  if (sender->metaObject()->indexOfSignal(signature) < 0) {
+    return false;
+  }
+  CoroutineWaker *waker = timers_create_waker(L, msec);
+  // Signal code is required by string based QObject::connect
+  QObject::connect(sender, "2" + signature, waker, SLOT(wake()));
+  return true;
+}
+
+// await(object[, signal[, msec]])
+// Suspends the coroutine started by async() until signal of the Qt or qt.dynamic object
+// is emitted or msec expires, the event loop keeps running meanwhile.
+// Signal of timers.Timer is "timeout()" by default.
+// Returns true if the signal has been emitted, false on timeout.
+int await_signal(lua_State *L) {
+  if (!timers_in_async(L)) {
+    return luaL_error(L, "await: must be called from a coroutine started by async()");
+  }
+  QObject *sender = lua_type(L, 1) == LUA_TUSERDATA ? *static_cast<QObject**>(lua_touserdata(L, 1)) : NULL;
+  luaL_argcheck(L, sender != NULL, 1, "qt object expected");
+  const char *signal = luaL_testudata(L, 1, "timers.Timer")
+    ? luaL_optstring(L, 2, "timeout()") : luaL_checkstring(L, 2);
+  const int msec = luaL_optinteger(L, 3, -1);
+  if (!connect_waker(L, sender, qtlua_isdynamic(L, 1), signal, msec)) {
+    return luaL_argerror(L, 2, "unknown signal");
+  }
+  return lua_yield(L, 0);
+}
 }  // anonymous namespace
 LuaInterpreter::LuaInterpreter(QObject *parent, const QStringList::iterator& args, const QStringList::iterator& args_end)
   : QObject(parent) {
@@ -63,7 +123,11 @@ LuaInterpreter::LuaInterpreter(QObject *parent, const QStringList::iterator& arg
   luaL_requiref(lua_state, "base", &luaopen_base, 1);
   luaL_requiref(lua_state, "package", &luaopen_package, 1);
   luaL_requiref(lua_state, "network", &luaopen_network, 1);
+  luaL_requiref(lua_state, "protocol", &luaopen_protocol, 1);
+  luaL_requiref(lua_state, "json", &luaopen_json, 1);
+  luaL_requiref(lua_state, "api_schema", &luaopen_api_schema, 1);
   luaL_requiref(lua_state, "timers", &luaopen_timers, 1);
+  luaL_requiref(lua_state, "process", &luaopen_process, 1);
   luaL_requiref(lua_state, "string", &luaopen_string, 1);
   luaL_requiref(lua_state, "table", &luaopen_table, 1);
   luaL_requiref(lua_state, "debug", &luaopen_debug, 1);
@@ -73,6 +137,7 @@ LuaInterpreter::LuaInterpreter(QObject *parent, const QStringList::iterator& arg
   luaL_requiref(lua_state, "bit32", &luaopen_bit32, 1);
   luaL_requiref(lua_state, "qt", &luaopen_qt, 1);
   luaL_requiref(lua_state, "qdatetime", &luaopen_qdatetime, 1);
+  luaL_requiref(lua_state, "logsink", &luaopen_logsink, 1);
 
 #line 192 "main.nw"
   // extend package.cpath
@@ -99,6 +164,12 @@ LuaInterpreter::LuaInterpreter(QObject *parent, const QStringList::iterator& arg
   lua_pushcfunction(lua_state, &arguments);
   lua_setglobal(lua_state, "arguments");
 
+  lua_pushcfunction(lua_state, &async_call);
+  lua_setglobal(lua_state, "async");
+
+  lua_pushcfunction(lua_state, &await_signal);
+  lua_setglobal(lua_state, "await");
+
   lua_pushboolean(lua_state, !isatty(fileno(stdout)));
   lua_setglobal(lua_state, "is_redirected");
 
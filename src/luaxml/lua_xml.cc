@@ -13,9 +13,14 @@ extern "C" {
 #include <libxml/xmlsave.h>
 
 #include <iostream>
+#include <string>
+#include <new>
 #include <assert.h>
+#include <errno.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 namespace {
 void genericErrorHandler(void *ctx, const char* message, ...){
@@ -236,6 +241,7 @@ int node_addChild(lua_State *L) {
   *p = node;
   luaL_getmetatable(L, "xml.Node");
   lua_setmetatable(L, -2);
+  return 1;
 }
 
 int xml_close(lua_State *L) {
@@ -379,6 +385,128 @@ int node_attributes(lua_State *L) {
   return 1;
 }
 
+// Append-only document: the root element is written once,
+// then complete child elements are appended as they are finished.
+// Pending output is written in batches, the file is kept well-formed after every write:
+// the closing tag of the root is rewritten behind the last appended element.
+// The last appended element can be replaced, e.g. when a finished test step gets more messages.
+const size_t kStreamBatchSize = 64 * 1024;
+
+struct XmlStream {
+  FILE *file;
+  std::string closingTag;
+  std::string pending;
+  long tail;  // Offset of the closing tag of the root
+  long last;  // Offset of the last appended element, -1 if there is none
+};
+
+XmlStream* check_stream(lua_State *L, int idx) {
+  XmlStream *stream = static_cast<XmlStream*>(luaL_checkudata(L, idx, "xml.Stream"));
+  if (!stream->file) {
+    luaL_error(L, "xml.Stream is closed");
+  }
+  return stream;
+}
+
+bool stream_flush(XmlStream *stream) {
+  if (fseek(stream->file, stream->tail, SEEK_SET) != 0) {
+    return false;
+  }
+  fwrite(stream->pending.data(), 1, stream->pending.size(), stream->file);
+  stream->pending.clear();
+  stream->tail = ftell(stream->file);
+  fwrite(stream->closingTag.data(), 1, stream->closingTag.size(), stream->file);
+  if (fflush(stream->file) != 0) {
+    return false;
+  }
+  // A replaced element may have been longer than the new one
+  return ftruncate(fileno(stream->file), stream->tail + stream->closingTag.size()) == 0;
+}
+
+void stream_append(XmlStream *stream, xmlNodePtr node) {
+  stream->last = stream->tail + stream->pending.size();
+  xmlBufferPtr buffer = xmlBufferCreate();
+  xmlNodeDump(buffer, node->doc, node, 1, 1);
+  stream->pending.append("  ");
+  stream->pending.append(reinterpret_cast<const char*>(xmlBufferContent(buffer)),
+                         xmlBufferLength(buffer));
+  stream->pending.append("\n");
+  xmlBufferFree(buffer);
+  if (stream->pending.size() >= kStreamBatchSize) {
+    stream_flush(stream);
+  }
+}
+
+// xml.stream(filename, rootName)
+int xml_stream(lua_State *L) {
+  const char *filename = luaL_checkstring(L, 1);
+  const char *rootName = luaL_checkstring(L, 2);
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    lua_pushnil(L);
+    lua_pushstring(L, strerror(errno));
+    return 2;
+  }
+  XmlStream *stream = static_cast<XmlStream*>(lua_newuserdata(L, sizeof(XmlStream)));
+  new (stream) XmlStream();
+  stream->file = file;
+  stream->closingTag = std::string("</") + rootName + ">\n";
+  stream->tail = 0;
+  stream->last = -1;
+  stream->pending = std::string("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<") + rootName + ">\n";
+  luaL_getmetatable(L, "xml.Stream");
+  lua_setmetatable(L, -2);
+  stream_flush(stream);
+  return 1;
+}
+
+// stream:write(node): appends formatted element with all its children
+int stream_write(lua_State *L) {
+  XmlStream *stream = check_stream(L, 1);
+  xmlNodePtr node = *static_cast<xmlNodePtr*>(luaL_checkudata(L, 2, "xml.Node"));
+  stream_append(stream, node);
+  return 0;
+}
+
+// stream:rewrite(node): replaces the last appended element by node
+int stream_rewrite(lua_State *L) {
+  XmlStream *stream = check_stream(L, 1);
+  xmlNodePtr node = *static_cast<xmlNodePtr*>(luaL_checkudata(L, 2, "xml.Node"));
+  if (stream->last < 0) {
+    return luaL_error(L, "xml.Stream: no element to rewrite");
+  }
+  if (stream->last >= stream->tail) {
+    stream->pending.resize(stream->last - stream->tail);
+  } else {
+    // The element has been written already and nothing follows it
+    stream->pending.clear();
+    stream->tail = stream->last;
+  }
+  stream_append(stream, node);
+  return 0;
+}
+
+int stream_flush(lua_State *L) {
+  lua_pushboolean(L, stream_flush(check_stream(L, 1)));
+  return 1;
+}
+
+int stream_close(lua_State *L) {
+  XmlStream *stream = static_cast<XmlStream*>(luaL_checkudata(L, 1, "xml.Stream"));
+  if (stream->file) {
+    stream_flush(stream);
+    fclose(stream->file);
+    stream->file = nullptr;
+  }
+  return 0;
+}
+
+int stream_delete(lua_State *L) {
+  stream_close(L);
+  static_cast<XmlStream*>(lua_touserdata(L, 1))->~XmlStream();
+  return 0;
+}
+
 int node_eq(lua_State *L) {
   xmlNodePtr a = *static_cast<xmlNodePtr*>(luaL_checkudata(L, 1, "xml.Node"));
   xmlNodePtr b = *static_cast<xmlNodePtr*>(luaL_checkudata(L, 2, "xml.Node"));
@@ -396,6 +524,7 @@ int luaopen_xml(lua_State *L, int ) {
   luaL_Reg functions[] = {
     { "open", &xml_open },
     { "new", &xml_new },
+    { "stream", &xml_stream },
     { NULL, NULL }
   };
 
@@ -432,6 +561,20 @@ int luaopen_xml(lua_State *L, int ) {
   lua_pushcfunction(L, &node_eq);
   lua_setfield(L, -2, "__eq");
 
+  luaL_newmetatable(L, "xml.Stream");
+  lua_newtable(L);
+  luaL_Reg stream_functions[] = {
+    { "write", &stream_write },
+    { "rewrite", &stream_rewrite },
+    { "flush", &stream_flush },
+    { "close", &stream_close },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, stream_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, &stream_delete);
+  lua_setfield(L, -2, "__gc");
+
   luaL_newlib(L, functions);
   return 1;
 }
@@ -10,6 +10,8 @@ extern "C" {
 #include <QMap>
 #include <QList>
 #include <QString>
+#include <QByteArray>
+#include <new>
 #line 241 "qtlua.nw"
 QList<Marshaller*> get_marshalling_list(const char* signature)
 {
@@ -30,19 +32,21 @@ QList<Marshaller*> get_marshalling_list(const char* signature)
   return retval;
 }
 #line 262 "qtlua.nw"
+static_assert(sizeof(Marshaller::Storage) >= sizeof(QString)
+  && sizeof(Marshaller::Storage) >= sizeof(QByteArray)
+  && sizeof(Marshaller::Storage) >= sizeof(qint64), "Marshaller::Storage is too small");
+
 namespace {
   // int Marshaller
   class : public Marshaller {
    public:
-    void* Marshal(lua_State *L, int index) {
+    void* Marshal(lua_State *L, int index, Storage *storage) {
       int isnum = 0;
       int val = lua_tointegerx(L, index, &isnum);
-      if (!isnum)
-        return NULL;
-      return new int(val);
+      return new (storage) int(isnum ? val : 0);
     }
     void Dispose(void *obj) {
-      delete static_cast<int*>(obj);
+      (void)obj;
     }
     void Unmarshal(void *obj, lua_State *L) {
       lua_pushinteger(L, *static_cast<int*>(obj));
@@ -51,15 +55,13 @@ namespace {
   // qint64 Marshaller
   class : public Marshaller {
    public:
-    void* Marshal(lua_State *L, int index) {
+    void* Marshal(lua_State *L, int index, Storage *storage) {
       int isnum = 0;
       qint64 val = lua_tointegerx(L, index, &isnum);
-      if (!isnum)
-        return NULL;
-      return new qint64(val);
+      return new (storage) qint64(isnum ? val : 0);
     }
     void Dispose(void *obj) {
-      delete static_cast<qint64*>(obj);
+      (void)obj;
     }
     void Unmarshal(void *obj, lua_State *L) {
       lua_pushinteger(L, *static_cast<qint64*>(obj));
@@ -69,14 +71,14 @@ namespace {
   // QString Marshaller
   class : public Marshaller {
    public:
-    void* Marshal(lua_State *L, int index) {
+    void* Marshal(lua_State *L, int index, Storage *storage) {
       const char * val = lua_tostring(L, index);
       if (!val)
-        return NULL;
-      return new QString(val);
+        return new (storage) QString();
+      return new (storage) QString(val);
     }
     void Dispose(void *obj) {
-      delete static_cast<QString*>(obj);
+      static_cast<QString*>(obj)->~QString();
     }
     void Unmarshal(void *obj, lua_State *L) {
       lua_pushstring(L, static_cast<QString*>(obj)->toUtf8().constData());
@@ -85,15 +87,15 @@ namespace {
   // QByteArray Marshaller
   class : public Marshaller {
    public:
-    void* Marshal(lua_State *L, int index) {
+    void* Marshal(lua_State *L, int index, Storage *storage) {
       size_t size;
       const char * val = lua_tolstring(L, index, &size);
       if (!val)
-        return NULL;
-      return new QByteArray(val, size);
+        return new (storage) QByteArray();
+      return new (storage) QByteArray(val, size);
     }
     void Dispose(void *obj) {
-      delete static_cast<QByteArray*>(obj);
+      static_cast<QByteArray*>(obj)->~QByteArray();
     }
     void Unmarshal(void *obj, lua_State *L) {
       QByteArray *ba = static_cast<QByteArray*>(obj);
@@ -103,12 +105,12 @@ namespace {
   // bool Marshaller
   class : public Marshaller {
    public:
-    void* Marshal(lua_State *L, int index) {
+    void* Marshal(lua_State *L, int index, Storage *storage) {
       bool val = lua_toboolean(L, index);
-      return new bool(val);
+      return new (storage) bool(val);
     }
     void Dispose(void *obj) {
-      delete static_cast<bool*>(obj);
+      (void)obj;
     }
     void Unmarshal(void *obj, lua_State *L) {
       lua_pushboolean(L, *static_cast<bool*>(obj));
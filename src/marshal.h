@@ -10,12 +10,19 @@ extern "C" {
 #include <QList>
 #include <QMap>
 #include <QString>
+#include <type_traits>
 
 class Marshaller
 {
  public:
+  // Caller provided storage of a marshalled value, fits any supported type
+  typedef std::aligned_storage<16, 8>::type Storage;
   static Marshaller *get(const QString& type);
-  virtual void* Marshal(lua_State *L, int index) = 0;
+  // Constructs the value at index in storage and returns pointer to it.
+  // A missing or unconvertible Lua value gives the default value of the type,
+  // the same one a queued connection delivers
+  virtual void* Marshal(lua_State *L, int index, Storage *storage) = 0;
+  // Destroys the value constructed by Marshal
   virtual void Dispose(void *obj) = 0;
   virtual void Unmarshal(void *obj, lua_State *L) = 0;
 };
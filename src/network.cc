@@ -17,11 +17,242 @@
 #include <unistd.h>
 #include <errno.h>
 #include <cstring>
+#include <climits>
 #include <cstdio>
+
+namespace {
+const int kInitialRetryDelayMs = 50;
+const int kMaxRetryDelayMs = 1000;
+const int kDefaultProbeIntervalMs = 5;
+const int kDefaultHighWatermark = 64 * 1024;
+const int kDefaultLowWatermark = 16 * 1024;
+const unsigned kTcpListenState = 0x0A;
+
+// Checks whether a socket from the kernel table (/proc/net/tcp format) listens on port
+bool table_has_listener(const char *table, quint16 port) {
+  FILE *file = fopen(table, "r");
+  if (!file) {
+    return false;
+  }
+  char line[512];
+  bool found = false;
+  if (fgets(line, sizeof(line), file)) {  // skip header
+    while (!found && fgets(line, sizeof(line), file)) {
+      // sl local_address rem_address st ...
+      char local[64];
+      unsigned state;
+      if (sscanf(line, "%*s %63s %*s %x", local, &state) == 2 && state == kTcpListenState) {
+        const char *colon = strrchr(local, ':');
+        found = colon && strtoul(colon + 1, NULL, 16) == port;
+      }
+    }
+  }
+  fclose(file);
+  return found;
+}
+}
+
+ConnectRetry::ConnectRetry(QObject *parent)
+  : QObject(parent), delay_(kInitialRetryDelayMs) {
+  retryTimer_.setSingleShot(true);
+  deadlineTimer_.setSingleShot(true);
+  connect(&retryTimer_, SIGNAL(timeout()), this, SIGNAL(attempt()));
+  connect(&deadlineTimer_, SIGNAL(timeout()), this, SLOT(onDeadline()));
+}
+
+bool ConnectRetry::isActive() const {
+  return deadlineTimer_.isActive();
+}
+
+void ConnectRetry::start(int timeout_ms) {
+  retryTimer_.stop();
+  delay_ = kInitialRetryDelayMs;
+  deadlineTimer_.start(qMax(timeout_ms, 0));
+}
+
+void ConnectRetry::retry() {
+  if (!isActive() || retryTimer_.isActive()) {
+    return;
+  }
+  retryTimer_.start(delay_);
+  delay_ = qMin(delay_ * 2, kMaxRetryDelayMs);
+}
+
+void ConnectRetry::stop() {
+  retryTimer_.stop();
+  deadlineTimer_.stop();
+}
+
+void ConnectRetry::onDeadline() {
+  retryTimer_.stop();
+  emit expired();
+}
+
+TcpClient::TcpClient(QObject *parent)
+  : QTcpSocket(parent), port_(0), timeout_(0) {
+  connect(&retry_, SIGNAL(attempt()), this, SLOT(attemptConnect()));
+  connect(&retry_, SIGNAL(expired()), this, SLOT(onConnectTimeout()));
+  connect(this, SIGNAL(connected()), &retry_, SLOT(stop()));
+  connect(this, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(onError()));
+}
+
+void TcpClient::connectAsync(const QString &host, quint16 port, int timeout_ms, const QString &source) {
+  host_ = host;
+  port_ = port;
+  source_ = source;
+  timeout_ = timeout_ms;
+  retry_.start(timeout_ms);
+  attemptConnect();
+}
+
+void TcpClient::attemptConnect() {
+  abort();
+  // Bind source address if it's defined
+  if (!source_.isEmpty()) {
+    bind(QHostAddress(source_));
+  }
+  connectToHost(host_, port_);
+}
+
+void TcpClient::onError() {
+  retry_.retry();
+}
+
+void TcpClient::onConnectTimeout() {
+  abort();
+  fprintf(stderr, "Error: TCP Connection not established during %d ms\n", timeout_);
+  emit connectFailed();
+}
+
+WebSocket::WebSocket(QObject *parent)
+  : QWebSocket(QString(), QWebSocketProtocol::VersionLatest, parent), timeout_(0) {
+  connect(&retry_, SIGNAL(attempt()), this, SLOT(attemptOpen()));
+  connect(&retry_, SIGNAL(expired()), this, SLOT(onConnectTimeout()));
+  connect(this, SIGNAL(connected()), &retry_, SLOT(stop()));
+  connect(this, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(onError()));
+}
+
+void WebSocket::openAsync(const QUrl &url, int timeout_ms) {
+  url_ = url;
+  timeout_ = timeout_ms;
+  retry_.start(timeout_ms);
+  attemptOpen();
+}
+
+void WebSocket::attemptOpen() {
+  abort();
+  open(url_);
+}
+
+void WebSocket::onError() {
+  retry_.retry();
+}
+
+void WebSocket::onConnectTimeout() {
+  abort();
+  fprintf(stderr, "Error: WS Connection not established during %d ms\n", timeout_);
+  emit connectFailed();
+}
+
+ListenProbe::ListenProbe(QObject *parent)
+  : QObject(parent), port_(0) {
+  connect(&timer_, SIGNAL(timeout()), this, SLOT(check()));
+}
+
+void ListenProbe::start(quint16 port, int interval_ms) {
+  port_ = port;
+  timer_.start(interval_ms > 0 ? interval_ms : kDefaultProbeIntervalMs);
+  // The first check is done from the event loop, so ready() is never emitted from start()
+  QTimer::singleShot(0, this, SLOT(check()));
+}
+
+bool ListenProbe::isListening(quint16 port) {
+  return table_has_listener("/proc/net/tcp", port) || table_has_listener("/proc/net/tcp6", port);
+}
+
+void ListenProbe::stop() {
+  timer_.stop();
+}
+
+void ListenProbe::check() {
+  if (timer_.isActive() && isListening(port_)) {
+    timer_.stop();
+    emit ready();
+  }
+}
+
+SendQueue::SendQueue(QAbstractSocket *socket, qint64 high, qint64 low, QObject *parent)
+  : QObject(parent), socket_(socket), high_(high), low_(qMin(low, high)), sent_(0),
+    blocked_(false), notifyWritable_(false) {
+  connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)));
+}
+
+void SendQueue::setWatermarks(qint64 high, qint64 low) {
+  high_ = high;
+  low_ = qMin(low, high);
+  updateBlocked();
+}
+
+bool SendQueue::write(const char *data, qint64 size) {
+  if (!socket_ || !socket_->isOpen()) {
+    return false;
+  }
+  if (!clock_.isValid()) {
+    clock_.start();
+  }
+  socket_->write(data, size);
+  if (inFlight() >= high_) {
+    blocked_ = true;
+  }
+  // The writer which is told to wait gets writable() once the queue falls to the low watermark
+  notifyWritable_ = notifyWritable_ || blocked_;
+  return !blocked_;
+}
+
+bool SendQueue::isWritable() {
+  if (!socket_ || !socket_->isOpen()) {
+    return false;
+  }
+  // Checked on demand too: a handler of bytesWritten() may run before onBytesWritten()
+  updateBlocked();
+  return !blocked_;
+}
+
+qint64 SendQueue::inFlight() const {
+  return socket_ ? socket_->bytesToWrite() : 0;
+}
+
+qint64 SendQueue::bytesSent() const {
+  return sent_;
+}
+
+double SendQueue::throughput() const {
+  const qint64 elapsed = clock_.isValid() ? clock_.elapsed() : 0;
+  return elapsed > 0 ? sent_ * 1000.0 / elapsed : 0.0;
+}
+
+void SendQueue::updateBlocked() {
+  if (blocked_ && inFlight() <= low_) {
+    blocked_ = false;
+  }
+}
+
+void SendQueue::onBytesWritten(qint64 bytes) {
+  sent_ += bytes;
+  updateBlocked();
+  if (notifyWritable_ && !blocked_) {
+    notifyWritable_ = false;
+    emit writable();
+  }
+  if (inFlight() == 0) {
+    emit drained();
+  }
+}
+
 #line 22 "network.nw"
 // TcpClient functions/*{{{*/
 int network_tcp_client(lua_State *L) {/*{{{*/
-  QTcpSocket  *tcpSocket = new QTcpSocket();
+  QTcpSocket  *tcpSocket = new TcpClient();
   QTcpSocket **p = static_cast<QTcpSocket**>(lua_newuserdata(L, sizeof(QTcpServer*)));
   *p = tcpSocket;
   luaL_getmetatable(L, "network.TcpSocket");
@@ -57,6 +288,18 @@ QTcpSocket *tcpSocket =
   }
   return 0;
 }/*}}}*/
+int tcp_socket_connect_async(lua_State *L) {/*{{{*/
+  QTcpSocket *tcpSocket =
+    *static_cast<QTcpSocket**>(luaL_checkudata(L, 1, "network.TcpSocket"));
+  TcpClient *tcpClient = qobject_cast<TcpClient*>(tcpSocket);
+  luaL_argcheck(L, tcpClient != NULL, 1, "socket is not a TcpClient");
+  const char* ip = luaL_checkstring(L, 2);
+  int port = luaL_checkinteger(L, 3);
+  const int time_waiting_ms = lua_tointegerx(L, 4, NULL);
+  const char* source = luaL_optstring(L, 5, "");
+  tcpClient->connectAsync(ip, port, time_waiting_ms, source);
+  return 0;
+}/*}}}*/
 int tcp_socket_read(lua_State *L) {/*{{{*/
 
 #line 65 "network.nw"
@@ -85,6 +328,27 @@ QTcpSocket *tcpSocket =
   return 1;
 }/*}}}*/
 
+int tcp_socket_read_into(lua_State *L) {/*{{{*/
+  QTcpSocket *tcpSocket =
+    *static_cast<QTcpSocket**>(luaL_checkudata(L, 1, "network.TcpSocket"));
+  QByteArray *buffer =
+    *static_cast<QByteArray**>(luaL_checkudata(L, 2, "network.Buffer"));
+  const qint64 maxSize = luaL_optinteger(L, 3, tcpSocket->bytesAvailable());
+  luaL_argcheck(L, maxSize >= 0 && maxSize <= INT_MAX - buffer->size(), 3, "invalid size");
+  if (!tcpSocket->isOpen()) {
+    fprintf(stderr, "Error: Socket not opened");
+    lua_pushinteger(L, 0);
+    return 1;
+  }
+  // Data is read directly behind the current contents of the buffer
+  const int offset = buffer->size();
+  buffer->resize(offset + maxSize);
+  const qint64 result = tcpSocket->read(buffer->data() + offset, maxSize);
+  buffer->resize(offset + qMax<qint64>(result, 0));
+  lua_pushinteger(L, qMax<qint64>(result, 0));
+  return 1;
+}/*}}}*/
+
 int tcp_socket_write(lua_State *L) {/*{{{*/
 
 #line 65 "network.nw"
@@ -101,6 +365,63 @@ QTcpSocket *tcpSocket =
   }
   return 1;
 }/*}}}*/
+// Returns data of a write_many part, which is either a string or network.Buffer
+static const char *write_part(lua_State *L, int idx, size_t *size) {
+  const QByteArray *buffer = network_to_buffer(L, idx);
+  if (buffer) {
+    *size = buffer->size();
+    return buffer->constData();
+  }
+  if (lua_type(L, idx) != LUA_TSTRING) {
+    luaL_error(L, "write_many: string or network.Buffer expected");
+  }
+  return lua_tolstring(L, idx, size);
+}
+
+// socket:write_many(parts)
+// Writes an array of strings and buffers with one call, returns number of bytes written.
+// All parts land in the socket write buffer at once, so they are flushed
+// to the kernel together and reported by one bytesWritten signal
+int tcp_socket_write_many(lua_State *L) {/*{{{*/
+  QTcpSocket *tcpSocket =
+    *static_cast<QTcpSocket**>(luaL_checkudata(L, 1, "network.TcpSocket"));
+  luaL_checktype(L, 2, LUA_TTABLE);
+  if (!tcpSocket->isOpen()) {
+    fprintf(stderr, "Error: Socket not opened");
+    lua_pushinteger(L, -1);
+    return 1;
+  }
+  const int count = lua_rawlen(L, 2);
+  qint64 total = 0;
+  for (int i = 1; i <= count; ++i) {
+    lua_rawgeti(L, 2, i);
+    size_t size;
+    const char *data = write_part(L, -1, &size);
+    const qint64 result = tcpSocket->write(data, size);
+    lua_pop(L, 1);
+    if (result < 0) {
+      total = -1;
+      break;
+    }
+    total += result;
+  }
+  lua_pushinteger(L, total);
+  return 1;
+}/*}}}*/
+// socket:send_queue([high[, low]])
+// Creates network.SendQueue writing to the socket with given watermarks in bytes
+int tcp_socket_send_queue(lua_State *L) {/*{{{*/
+  QTcpSocket *tcpSocket =
+    *static_cast<QTcpSocket**>(luaL_checkudata(L, 1, "network.TcpSocket"));
+  const int high = luaL_optinteger(L, 2, kDefaultHighWatermark);
+  const int low = luaL_optinteger(L, 3, qMin(kDefaultLowWatermark, high));
+  luaL_argcheck(L, high > 0, 2, "high watermark must be positive");
+  SendQueue **p = static_cast<SendQueue**>(lua_newuserdata(L, sizeof(SendQueue*)));
+  *p = new SendQueue(tcpSocket, high, low);
+  luaL_getmetatable(L, "network.SendQueue");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
 int tcp_socket_close(lua_State *L) {/*{{{*/
 
 #line 65 "network.nw"
@@ -177,7 +498,7 @@ QTcpServer *tcpServer =
 #line 115 "network.nw"
 // WebSocket functions/*{{{*/
 int network_web_socket(lua_State *L) {/*{{{*/
-  QWebSocket *webSocket = new QWebSocket();
+  QWebSocket *webSocket = new WebSocket();
   QWebSocket **p = static_cast<QWebSocket**>(lua_newuserdata(L, sizeof(QWebSocket*)));
   *p = webSocket;
   luaL_getmetatable(L, "network.WebSocket");
@@ -202,6 +523,52 @@ void setCypherList(QSslConfiguration& sslConfiguration, const QString& cypherLis
     }
 }
 
+// Sets up QSslConfiguration from table of ssl parameters at index idx
+void setSslConfiguration(lua_State *L, int idx, QWebSocket *webSocket) {
+  lua_getfield(L, idx, "protocol");
+  const QSsl::SslProtocol protocol = static_cast<QSsl::SslProtocol>(lua_tointeger(L, -1));
+  lua_pop(L, 1);
+
+  lua_getfield(L, idx, "cypherListString");
+  const QString cypherListString = lua_tostring(L, -1);
+  lua_pop(L, 1);
+
+  lua_getfield(L, idx, "caCertPath");
+  const QString caCertPath = lua_tostring(L, -1);
+  lua_pop(L, 1);
+  QFile caCertFile(caCertPath);
+  caCertFile.open(QIODevice::ReadOnly);
+  QSslCertificate caCertificate(&caCertFile, QSsl::Pem);
+  caCertFile.close();
+  QList<QSslCertificate> caCertificates;
+  caCertificates << caCertificate;
+
+  lua_getfield(L, idx, "certPath");
+  const QString certPath = lua_tostring(L, -1);
+  lua_pop(L, 1);
+  QFile certFile(certPath);
+  certFile.open(QIODevice::ReadOnly);
+  QSslCertificate certificate(&certFile, QSsl::Pem);
+  certFile.close();
+
+  lua_getfield(L, idx, "keyPath");
+  const QString keyPath = lua_tostring(L, -1);
+  lua_pop(L, 1);
+  QFile keyFile(keyPath);
+  keyFile.open(QIODevice::ReadOnly);
+  QSslKey sslKey(&keyFile, QSsl::Rsa, QSsl::Pem);
+  keyFile.close();
+
+  QSslConfiguration sslConfiguration;
+  sslConfiguration.setProtocol(protocol);
+  setCypherList(sslConfiguration, cypherListString);
+  sslConfiguration.setPeerVerifyMode(QSslSocket::VerifyPeer);
+  sslConfiguration.setCaCertificates(caCertificates);
+  sslConfiguration.setLocalCertificate(certificate);
+  sslConfiguration.setPrivateKey(sslKey);
+  webSocket->setSslConfiguration(sslConfiguration);
+}
+
 int web_socket_open(lua_State *L) {/*{{{*/
 
 #line 153 "network.nw"
@@ -213,48 +580,7 @@ QWebSocket *webSocket =
   const int time_waiting_ms = lua_tointegerx(L, 4, NULL);
   // check wheather ssl parameters passed then construct and set QSslConfiguration
   if (!lua_isnoneornil(L, 5)) {
-    lua_getfield(L, 5, "protocol");
-    const QSsl::SslProtocol protocol = static_cast<QSsl::SslProtocol>(lua_tointeger(L, -1));
-    lua_pop(L, 1);
-
-    lua_getfield(L, 5, "cypherListString");
-    const QString cypherListString = lua_tostring(L, -1);
-    lua_pop(L, 1);
-
-    lua_getfield(L, 5, "caCertPath");
-    const QString caCertPath = lua_tostring(L, -1);
-    lua_pop(L, 1);
-    QFile caCertFile(caCertPath);
-    caCertFile.open(QIODevice::ReadOnly);
-    QSslCertificate caCertificate(&caCertFile, QSsl::Pem);
-    caCertFile.close();
-    QList<QSslCertificate> caCertificates;
-    caCertificates << caCertificate;
-
-    lua_getfield(L, 5, "certPath");
-    const QString certPath = lua_tostring(L, -1);
-    lua_pop(L, 1);
-    QFile certFile(certPath);
-    certFile.open(QIODevice::ReadOnly);
-    QSslCertificate certificate(&certFile, QSsl::Pem);
-    certFile.close();
-
-    lua_getfield(L, 5, "keyPath");
-    const QString keyPath = lua_tostring(L, -1);
-    lua_pop(L, 1);
-    QFile keyFile(keyPath);
-    keyFile.open(QIODevice::ReadOnly);
-    QSslKey sslKey(&keyFile, QSsl::Rsa, QSsl::Pem);
-    keyFile.close();
-
-    QSslConfiguration sslConfiguration;
-    sslConfiguration.setProtocol(protocol);
-    setCypherList(sslConfiguration, cypherListString);
-    sslConfiguration.setPeerVerifyMode(QSslSocket::VerifyPeer);
-    sslConfiguration.setCaCertificates(caCertificates);
-    sslConfiguration.setLocalCertificate(certificate);
-    sslConfiguration.setPrivateKey(sslKey);
-    webSocket->setSslConfiguration(sslConfiguration);
+    setSslConfiguration(L, 5, webSocket);
   }
 
   QEventLoop loop;
@@ -280,6 +606,20 @@ QWebSocket *webSocket =
 
   return 0;
 }/*}}}*/
+int web_socket_open_async(lua_State *L) {/*{{{*/
+  QWebSocket *webSocket =
+    *static_cast<QWebSocket**>(luaL_checkudata(L, 1, "network.WebSocket"));
+  WebSocket *asyncWebSocket = qobject_cast<WebSocket*>(webSocket);
+  luaL_argcheck(L, asyncWebSocket != NULL, 1, "socket is not a WebSocket");
+  QUrl url(luaL_checkstring(L, 2));
+  url.setPort(lua_tointegerx(L, 3, NULL));
+  const int time_waiting_ms = lua_tointegerx(L, 4, NULL);
+  if (!lua_isnoneornil(L, 5)) {
+    setSslConfiguration(L, 5, webSocket);
+  }
+  asyncWebSocket->openAsync(url, time_waiting_ms);
+  return 0;
+}/*}}}*/
 int web_socket_close(lua_State *L) {/*{{{*/
 
 #line 153 "network.nw"
@@ -314,6 +654,29 @@ int web_socket_binarywrite(lua_State *L) {/*{{{*/
   return 1;
 }/*}}}*/
 
+// socket:write_many(parts[, binary])
+// Sends every string or buffer of the array as a separate message,
+// text messages by default, binary ones if the flag is set.
+// Returns total number of bytes sent
+int web_socket_write_many(lua_State *L) {/*{{{*/
+  QWebSocket *webSocket =
+  *static_cast<QWebSocket**>(luaL_checkudata(L, 1, "network.WebSocket"));
+  luaL_checktype(L, 2, LUA_TTABLE);
+  const bool binary = lua_toboolean(L, 3);
+  const int count = lua_rawlen(L, 2);
+  qint64 total = 0;
+  for (int i = 1; i <= count; ++i) {
+    lua_rawgeti(L, 2, i);
+    size_t size;
+    const char *data = write_part(L, -1, &size);
+    QByteArray b(data, size);
+    total += binary ? webSocket->sendBinaryMessage(b) : webSocket->sendTextMessage(b);
+    lua_pop(L, 1);
+  }
+  lua_pushinteger(L, total);
+  return 1;
+}/*}}}*/
+
 int web_socket_delete(lua_State *L) {/*{{{*/
 
 #line 153 "network.nw"
@@ -324,6 +687,166 @@ QWebSocket *webSocket =
   return 0;
 }/*}}}*/
 /*}}}*/
+// Buffer functions/*{{{*/
+const int kDefaultBufferCapacity = 81920;
+
+QByteArray* network_to_buffer(lua_State *L, int idx) {
+  QByteArray **p = static_cast<QByteArray**>(luaL_testudata(L, idx, "network.Buffer"));
+  return p ? *p : NULL;
+}
+
+QByteArray* check_buffer(lua_State *L, int idx) {
+  return *static_cast<QByteArray**>(luaL_checkudata(L, idx, "network.Buffer"));
+}
+
+int network_buffer(lua_State *L) {/*{{{*/
+  const int capacity = luaL_optinteger(L, 1, kDefaultBufferCapacity);
+  QByteArray *buffer = new QByteArray();
+  // Reserved capacity is kept by clear(), so the buffer is reused between reads
+  buffer->reserve(capacity);
+  QByteArray **p = static_cast<QByteArray**>(lua_newuserdata(L, sizeof(QByteArray*)));
+  *p = buffer;
+  luaL_getmetatable(L, "network.Buffer");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+int buffer_size(lua_State *L) {/*{{{*/
+  lua_pushinteger(L, check_buffer(L, 1)->size());
+  return 1;
+}/*}}}*/
+int buffer_sub(lua_State *L) {/*{{{*/
+  const QByteArray *buffer = check_buffer(L, 1);
+  const lua_Integer size = buffer->size();
+  // Same index semantics as string.sub
+  lua_Integer i = luaL_checkinteger(L, 2);
+  lua_Integer j = luaL_optinteger(L, 3, -1);
+  if (i < 0) i = qMax<lua_Integer>(size + i + 1, 1);
+  else if (i == 0) i = 1;
+  if (j < 0) j = size + j + 1;
+  else if (j > size) j = size;
+  if (i > j) {
+    lua_pushliteral(L, "");
+  } else {
+    lua_pushlstring(L, buffer->constData() + i - 1, j - i + 1);
+  }
+  return 1;
+}/*}}}*/
+int buffer_append(lua_State *L) {/*{{{*/
+  QByteArray *buffer = check_buffer(L, 1);
+  size_t size;
+  const char *data = luaL_checklstring(L, 2, &size);
+  buffer->append(data, size);
+  return 0;
+}/*}}}*/
+int buffer_tostring(lua_State *L) {/*{{{*/
+  const QByteArray *buffer = check_buffer(L, 1);
+  lua_pushlstring(L, buffer->constData(), buffer->size());
+  return 1;
+}/*}}}*/
+int buffer_clear(lua_State *L) {/*{{{*/
+  check_buffer(L, 1)->resize(0);
+  return 0;
+}/*}}}*/
+int buffer_delete(lua_State *L) {/*{{{*/
+  delete check_buffer(L, 1);
+  return 0;
+}/*}}}*/
+/*}}}*/
+// ListenProbe functions/*{{{*/
+ListenProbe* check_listen_probe(lua_State *L, int idx) {
+  return *static_cast<ListenProbe**>(luaL_checkudata(L, idx, "network.ListenProbe"));
+}
+
+int network_listen_probe(lua_State *L) {/*{{{*/
+  ListenProbe **p = static_cast<ListenProbe**>(lua_newuserdata(L, sizeof(ListenProbe*)));
+  *p = new ListenProbe();
+  luaL_getmetatable(L, "network.ListenProbe");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+// probe:start(port[, interval_ms]): emits ready() as soon as the port listens
+int listen_probe_start(lua_State *L) {/*{{{*/
+  ListenProbe *probe = check_listen_probe(L, 1);
+  const int port = luaL_checkinteger(L, 2);
+  const int interval = luaL_optinteger(L, 3, 0);
+  probe->start(port, interval);
+  return 0;
+}/*}}}*/
+int listen_probe_stop(lua_State *L) {/*{{{*/
+  check_listen_probe(L, 1)->stop();
+  return 0;
+}/*}}}*/
+// probe:listening(port): immediate check whether the port listens
+int listen_probe_listening(lua_State *L) {/*{{{*/
+  check_listen_probe(L, 1);
+  const int port = luaL_checkinteger(L, 2);
+  lua_pushboolean(L, ListenProbe::isListening(port));
+  return 1;
+}/*}}}*/
+int listen_probe_delete(lua_State *L) {/*{{{*/
+  delete check_listen_probe(L, 1);
+  return 0;
+}/*}}}*/
+/*}}}*/
+// SendQueue functions/*{{{*/
+SendQueue* check_send_queue(lua_State *L, int idx) {
+  return *static_cast<SendQueue**>(luaL_checkudata(L, idx, "network.SendQueue"));
+}
+
+// queue:write(data): data is a string or network.Buffer,
+// returns false once the high watermark is reached, the data is written anyway
+int send_queue_write(lua_State *L) {/*{{{*/
+  SendQueue *queue = check_send_queue(L, 1);
+  size_t size;
+  const char *data = write_part(L, 2, &size);
+  lua_pushboolean(L, queue->write(data, size));
+  return 1;
+}/*}}}*/
+// queue:write_many(parts): writes an array of strings and buffers, returns like write()
+int send_queue_write_many(lua_State *L) {/*{{{*/
+  SendQueue *queue = check_send_queue(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+  const int count = lua_rawlen(L, 2);
+  bool writable = queue->isWritable();
+  for (int i = 1; i <= count; ++i) {
+    lua_rawgeti(L, 2, i);
+    size_t size;
+    const char *data = write_part(L, -1, &size);
+    writable = queue->write(data, size);
+    lua_pop(L, 1);
+  }
+  lua_pushboolean(L, writable);
+  return 1;
+}/*}}}*/
+int send_queue_writable(lua_State *L) {/*{{{*/
+  lua_pushboolean(L, check_send_queue(L, 1)->isWritable());
+  return 1;
+}/*}}}*/
+// queue:in_flight(): bytes written but not yet taken by the kernel
+int send_queue_in_flight(lua_State *L) {/*{{{*/
+  lua_pushinteger(L, check_send_queue(L, 1)->inFlight());
+  return 1;
+}/*}}}*/
+// queue:stats(): bytes taken by the kernel and throughput in bytes per second
+int send_queue_stats(lua_State *L) {/*{{{*/
+  SendQueue *queue = check_send_queue(L, 1);
+  lua_pushnumber(L, queue->bytesSent());
+  lua_pushnumber(L, queue->throughput());
+  return 2;
+}/*}}}*/
+int send_queue_set_watermarks(lua_State *L) {/*{{{*/
+  SendQueue *queue = check_send_queue(L, 1);
+  const int high = luaL_checkinteger(L, 2);
+  const int low = luaL_checkinteger(L, 3);
+  luaL_argcheck(L, high > 0, 2, "high watermark must be positive");
+  queue->setWatermarks(high, low);
+  return 0;
+}/*}}}*/
+int send_queue_delete(lua_State *L) {/*{{{*/
+  delete check_send_queue(L, 1);
+  return 0;
+}/*}}}*/
+/*}}}*/
 #line 158 "network.nw"
 int luaopen_network(lua_State *L) {
   lua_newtable(L);
@@ -347,9 +870,13 @@ int luaopen_network(lua_State *L) {
   lua_newtable(L);
   luaL_Reg tcp_socket_functions[] = {
     { "connect", &tcp_socket_connect },
+    { "connect_async", &tcp_socket_connect_async },
     { "read", &tcp_socket_read },
     { "read_all", &tcp_socket_read_all },
+    { "read_into", &tcp_socket_read_into },
     { "write", &tcp_socket_write },
+    { "write_many", &tcp_socket_write_many },
+    { "send_queue", &tcp_socket_send_queue },
     { "close", &tcp_socket_close },
     { NULL, NULL }
   };
@@ -363,20 +890,72 @@ int luaopen_network(lua_State *L) {
   lua_newtable(L);
   luaL_Reg web_socket_functions[] = {
     { "open", &web_socket_open },
+    { "open_async", &web_socket_open_async },
     { "close", &web_socket_close },
     { "write", &web_socket_write },
     { "binary_write", &web_socket_binarywrite },
+    { "write_many", &web_socket_write_many },
     { NULL, NULL }
   };
   luaL_setfuncs(L, web_socket_functions, 0);
   lua_setfield(L, -2, "__index");
   lua_pushcfunction(L, web_socket_delete);
   lua_setfield(L, -2, "__gc");/*}}}*/
+  // Buffer metatable/*{{{*/
+  luaL_newmetatable(L, "network.Buffer");
+  lua_newtable(L);
+  luaL_Reg buffer_functions[] = {
+    { "size", &buffer_size },
+    { "sub", &buffer_sub },
+    { "append", &buffer_append },
+    { "tostring", &buffer_tostring },
+    { "clear", &buffer_clear },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, buffer_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, buffer_size);
+  lua_setfield(L, -2, "__len");
+  lua_pushcfunction(L, buffer_tostring);
+  lua_setfield(L, -2, "__tostring");
+  lua_pushcfunction(L, buffer_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // ListenProbe metatable/*{{{*/
+  luaL_newmetatable(L, "network.ListenProbe");
+  lua_newtable(L);
+  luaL_Reg listen_probe_functions[] = {
+    { "start", &listen_probe_start },
+    { "stop", &listen_probe_stop },
+    { "listening", &listen_probe_listening },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, listen_probe_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, listen_probe_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // SendQueue metatable/*{{{*/
+  luaL_newmetatable(L, "network.SendQueue");
+  lua_newtable(L);
+  luaL_Reg send_queue_functions[] = {
+    { "write", &send_queue_write },
+    { "write_many", &send_queue_write_many },
+    { "writable", &send_queue_writable },
+    { "in_flight", &send_queue_in_flight },
+    { "stats", &send_queue_stats },
+    { "set_watermarks", &send_queue_set_watermarks },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, send_queue_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, send_queue_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
 
   luaL_Reg network_functions[] = {
     { "TcpClient", &network_tcp_client },
     { "TcpServer", &network_tcp_server },
     { "WebSocket", &network_web_socket },
+    { "Buffer", &network_buffer },
+    { "ListenProbe", &network_listen_probe },
     { NULL, NULL }
   };
   luaL_newlib(L, network_functions);
@@ -8,7 +8,128 @@ extern "C" {
 }
 #line 6 "network.nw"
 #include <QObject>
+#include <QByteArray>
 #include <QAbstractSocket>
 #include <QTcpSocket>
 #include <QTcpServer>
+#include <QWebSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QString>
+#include <QPointer>
+#include <QElapsedTimer>
+
+// Repeats connection attempts with exponential backoff until deadline expires
+class ConnectRetry : public QObject {
+  Q_OBJECT
+ public:
+  explicit ConnectRetry(QObject *parent = 0);
+  bool isActive() const;
+  void start(int timeout_ms);
+  void retry();
+ public slots:
+  void stop();
+ signals:
+  void attempt();
+  void expired();
+ private slots:
+  void onDeadline();
+ private:
+  QTimer retryTimer_;
+  QTimer deadlineTimer_;
+  int delay_;
+};
+
+class TcpClient : public QTcpSocket {
+  Q_OBJECT
+ public:
+  explicit TcpClient(QObject *parent = 0);
+  void connectAsync(const QString &host, quint16 port, int timeout_ms, const QString &source);
+ signals:
+  void connectFailed();
+ private slots:
+  void attemptConnect();
+  void onError();
+  void onConnectTimeout();
+ private:
+  ConnectRetry retry_;
+  QString host_;
+  quint16 port_;
+  QString source_;
+  int timeout_;
+};
+
+class WebSocket : public QWebSocket {
+  Q_OBJECT
+ public:
+  explicit WebSocket(QObject *parent = 0);
+  void openAsync(const QUrl &url, int timeout_ms);
+ signals:
+  void connectFailed();
+ private slots:
+  void attemptOpen();
+  void onError();
+  void onConnectTimeout();
+ private:
+  ConnectRetry retry_;
+  QUrl url_;
+  int timeout_;
+};
+
+// Emits ready() once a TCP port starts listening on the local host.
+// Sockets table of the kernel (/proc/net/tcp, /proc/net/tcp6) is checked periodically,
+// so the probe doesn't connect to the port being watched.
+class ListenProbe : public QObject {
+  Q_OBJECT
+ public:
+  explicit ListenProbe(QObject *parent = 0);
+  void start(quint16 port, int interval_ms);
+  static bool isListening(quint16 port);
+ public slots:
+  void stop();
+ signals:
+  void ready();
+ private slots:
+  void check();
+ private:
+  QTimer timer_;
+  quint16 port_;
+};
+
+// Paces writes to a TCP socket by the amount of data not yet taken by the kernel.
+// Writes are never dropped: write() reports false once the high watermark is reached,
+// writable() is emitted when the queue falls to the low watermark, drained() when it is empty.
+class SendQueue : public QObject {
+  Q_OBJECT
+ public:
+  SendQueue(QAbstractSocket *socket, qint64 high, qint64 low, QObject *parent = 0);
+  void setWatermarks(qint64 high, qint64 low);
+  // Returns true while the queue is below the high watermark
+  bool write(const char *data, qint64 size);
+  // False for a socket which is not open
+  bool isWritable();
+  qint64 inFlight() const;
+  qint64 bytesSent() const;
+  // Bytes per second taken by the kernel since the first write
+  double throughput() const;
+ signals:
+  void writable();
+  void drained();
+ private slots:
+  void onBytesWritten(qint64 bytes);
+ private:
+  void updateBlocked();
+
+  QPointer<QAbstractSocket> socket_;
+  qint64 high_;
+  qint64 low_;
+  qint64 sent_;
+  bool blocked_;
+  bool notifyWritable_;
+  QElapsedTimer clock_;
+};
+
 int luaopen_network(lua_State *L);
+
+// Returns contents of network.Buffer at index idx or NULL if the value is not a buffer
+QByteArray* network_to_buffer(lua_State *L, int idx);
@@ -0,0 +1,487 @@
+#include "process.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QList>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern char **environ;
+
+namespace {
+const int kPollIntervalMs = 100;
+const int kWaitStepMs = 10;
+
+int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return syscall(SYS_pidfd_open, pid, 0);
+#else
+  (void)pid;
+  return -1;
+#endif
+}
+
+bool process_exists(pid_t pid) {
+  return kill(pid, 0) == 0 || errno == EPERM;
+}
+}  // anonymous namespace
+
+Process::Process(pid_t pid, int pidfd, bool child, QObject *parent)
+  : QObject(parent), pid_(pid), pidfd_(pidfd), child_(child), running_(true),
+    exitCode_(-1), exitSignal_(0), notifier_(NULL) {
+  if (pidfd_ >= 0) {
+    notifier_ = new QSocketNotifier(pidfd_, QSocketNotifier::Read, this);
+    connect(notifier_, SIGNAL(activated(int)), this, SLOT(check()));
+  } else {
+    connect(&pollTimer_, SIGNAL(timeout()), this, SLOT(check()));
+    pollTimer_.start(kPollIntervalMs);
+  }
+}
+
+Process::~Process() {
+  delete notifier_;
+  if (pidfd_ >= 0) {
+    close(pidfd_);
+  }
+}
+
+pid_t Process::pid() const {
+  return pid_;
+}
+
+bool Process::isRunning() {
+  return !checkFinished();
+}
+
+bool Process::waitForFinished(int msecs) {
+  QElapsedTimer timer;
+  timer.start();
+  while (!checkFinished()) {
+    int timeout = -1;
+    if (msecs >= 0) {
+      timeout = msecs - timer.elapsed();
+      if (timeout <= 0) {
+        return false;
+      }
+    }
+    if (pidfd_ >= 0) {
+      struct pollfd fd = { pidfd_, POLLIN, 0 };
+      poll(&fd, 1, timeout);
+    } else {
+      if (timeout < 0 || timeout > kWaitStepMs) {
+        timeout = kWaitStepMs;
+      }
+      usleep(timeout * 1000);
+    }
+  }
+  return true;
+}
+
+int Process::exitCode() const {
+  return exitCode_;
+}
+
+int Process::exitSignal() const {
+  return exitSignal_;
+}
+
+void Process::check() {
+  checkFinished();
+}
+
+bool Process::checkFinished() {
+  if (!running_) {
+    return true;
+  }
+  if (child_) {
+    int status = 0;
+    pid_t res = waitpid(pid_, &status, WNOHANG);
+    if (res == 0) {
+      return false;
+    }
+    if (res == pid_ && WIFEXITED(status)) {
+      exitCode_ = WEXITSTATUS(status);
+    } else if (res == pid_ && WIFSIGNALED(status)) {
+      exitSignal_ = WTERMSIG(status);
+    }
+    // res < 0: the child has already been reaped elsewhere, its status is unknown
+  } else if (pidfd_ >= 0) {
+    // pidfd becomes readable once the process has terminated, even if it is not reaped yet
+    struct pollfd fd = { pidfd_, POLLIN, 0 };
+    if (poll(&fd, 1, 0) == 0) {
+      return false;
+    }
+  } else if (process_exists(pid_)) {
+    return false;
+  }
+  running_ = false;
+  if (notifier_) {
+    notifier_->setEnabled(false);
+  }
+  pollTimer_.stop();
+  emit finished(exitCode_, exitSignal_);
+  return true;
+}
+
+namespace {
+Process* push_process(lua_State *L, pid_t pid, bool child) {
+  Process **p = static_cast<Process**>(lua_newuserdata(L, sizeof(Process*)));
+  *p = new Process(pid, open_pidfd(pid), child);
+  luaL_getmetatable(L, "process.Process");
+  lua_setmetatable(L, -2);
+  return *p;
+}
+
+// Pushes t[name] of the table at idx without invoking metamethods
+void push_raw_field(lua_State *L, int idx, const char *name) {
+  lua_pushstring(L, name);
+  lua_rawget(L, idx);
+}
+
+// Checks arguments of process.spawn before any C++ object is created:
+// Lua errors are raised with longjmp which skips destructors
+void check_spawn_args(lua_State *L) {
+  luaL_checkstring(L, 1);
+  if (!lua_isnoneornil(L, 2)) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    const int count = lua_rawlen(L, 2);
+    for (int i = 1; i <= count; ++i) {
+      lua_rawgeti(L, 2, i);
+      if (!lua_isstring(L, -1)) {
+        luaL_error(L, "process.spawn: argument %d must be a string", i);
+      }
+      lua_pop(L, 1);
+    }
+  }
+  if (lua_isnoneornil(L, 3)) {
+    return;
+  }
+  luaL_checktype(L, 3, LUA_TTABLE);
+  const char *options[] = { "cwd", "stdout", "stderr" };
+  for (const char *option : options) {
+    push_raw_field(L, 3, option);
+    if (!lua_isnil(L, -1) && !lua_isstring(L, -1)) {
+      luaL_error(L, "process.spawn: option %s must be a string", option);
+    }
+    lua_pop(L, 1);
+  }
+  push_raw_field(L, 3, "env");
+  if (lua_istable(L, -1)) {
+    const int env = lua_gettop(L);
+    lua_pushnil(L);
+    while (lua_next(L, env)) {
+      if (lua_type(L, -2) != LUA_TSTRING) {
+        luaL_error(L, "process.spawn: environment variable name must be a string");
+      }
+      if (!lua_isstring(L, -1)) {
+        luaL_error(L, "process.spawn: value of environment variable %s must be a string",
+                   lua_tostring(L, -2));
+      }
+      lua_pop(L, 1);
+    }
+  }
+  lua_pop(L, 1);
+}
+
+// String option of the table at idx, empty if it is not set
+QByteArray string_option(lua_State *L, int idx, const char *name) {
+  push_raw_field(L, idx, name);
+  QByteArray result(lua_isnil(L, -1) ? "" : lua_tostring(L, -1));
+  lua_pop(L, 1);
+  return result;
+}
+
+// Environment of the current process with overrides from the table at idx (0 for none).
+// Arguments have to be checked by check_spawn_args
+std::vector<QByteArray> build_environment(lua_State *L, int idx) {
+  std::vector<QByteArray> result;
+  QList<QByteArray> overridden;
+  if (idx != 0 && lua_istable(L, idx)) {
+    lua_pushnil(L);
+    while (lua_next(L, idx)) {
+      QByteArray name(lua_tostring(L, -2));
+      QByteArray value(lua_tostring(L, -1));
+      result.push_back(name + '=' + value);
+      overridden.append(name);
+      lua_pop(L, 1);
+    }
+  }
+  for (char **var = environ; *var; ++var) {
+    QByteArray entry(*var);
+    if (!overridden.contains(entry.left(entry.indexOf('=')))) {
+      result.push_back(entry);
+    }
+  }
+  return result;
+}
+
+// process.spawn(program[, args[, options]])
+// Starts program with the list of arguments without a shell.
+// Options: cwd - working directory, env - table of environment variables to set,
+// stdout, stderr - files to redirect output to.
+// Returns process.Process or nil and error message.
+int process_spawn(lua_State *L) {
+  check_spawn_args(L);
+  const char *program = lua_tostring(L, 1);
+  std::vector<QByteArray> args;
+  args.push_back(program);
+  if (!lua_isnoneornil(L, 2)) {
+    const int count = lua_rawlen(L, 2);
+    for (int i = 1; i <= count; ++i) {
+      lua_rawgeti(L, 2, i);
+      args.push_back(lua_tostring(L, -1));
+      lua_pop(L, 1);
+    }
+  }
+  QByteArray cwd, out, err;
+  std::vector<QByteArray> env;
+  if (!lua_isnoneornil(L, 3)) {
+    cwd = string_option(L, 3, "cwd");
+    out = string_option(L, 3, "stdout");
+    err = string_option(L, 3, "stderr");
+    push_raw_field(L, 3, "env");
+    env = build_environment(L, lua_gettop(L));
+    lua_pop(L, 1);
+  } else {
+    env = build_environment(L, 0);
+  }
+
+  std::vector<char*> argv, envp;
+  for (auto& arg : args) argv.push_back(arg.data());
+  argv.push_back(NULL);
+  for (auto& var : env) envp.push_back(var.data());
+  envp.push_back(NULL);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  const int flags = O_WRONLY | O_CREAT | O_APPEND;
+  if (!out.isEmpty()) {
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, out.constData(), flags, 0644);
+  }
+  if (!err.isEmpty()) {
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, err.constData(), flags, 0644);
+  }
+  // ATF may block or ignore signals which are inherited by the child
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t sigset;
+  sigemptyset(&sigset);
+  posix_spawnattr_setsigmask(&attr, &sigset);
+  sigaddset(&sigset, SIGINT);
+  sigaddset(&sigset, SIGTERM);
+  sigaddset(&sigset, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attr, &sigset);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+  if (!cwd.isEmpty()) {
+    posix_spawn_file_actions_addchdir_np(&actions, cwd.constData());
+  }
+  const QString prevCwd;
+#else
+  const QString prevCwd = QDir::currentPath();
+  if (!cwd.isEmpty() && !QDir::setCurrent(QString::fromLocal8Bit(cwd))) {
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    lua_pushnil(L);
+    lua_pushfstring(L, "process.spawn: unable to change directory to %s", cwd.constData());
+    return 2;
+  }
+#endif
+  pid_t pid = 0;
+  const int res = posix_spawn(&pid, program, &actions, &attr, argv.data(), envp.data());
+  if (!prevCwd.isEmpty()) {
+    QDir::setCurrent(prevCwd);
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  if (res != 0) {
+    lua_pushnil(L);
+    lua_pushfstring(L, "process.spawn: %s: %s", program, strerror(res));
+    return 2;
+  }
+  push_process(L, pid, true);
+  return 1;
+}
+
+// process.attach(pid)
+// Returns process.Process watching the running process not started by ATF or nil.
+int process_attach(lua_State *L) {
+  const pid_t pid = luaL_checkinteger(L, 1);
+  if (pid <= 0 || !process_exists(pid)) {
+    lua_pushnil(L);
+    return 1;
+  }
+  push_process(L, pid, false);
+  return 1;
+}
+
+// process.find(name)
+// Returns list of pids of processes which executable name is the base name of name.
+int process_find(lua_State *L) {
+  const char *name = luaL_checkstring(L, 1);
+  const char *base = strrchr(name, '/');
+  base = base ? base + 1 : name;
+  lua_newtable(L);
+  DIR *proc = opendir("/proc");
+  if (!proc) {
+    return 1;
+  }
+  const pid_t self = getpid();
+  int count = 0;
+  while (struct dirent *entry = readdir(proc)) {
+    char *end;
+    const pid_t pid = strtol(entry->d_name, &end, 10);
+    if (*end != '\0' || pid <= 0 || pid == self) {
+      continue;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+      continue;
+    }
+    char cmd[4096];
+    const size_t len = fread(cmd, 1, sizeof(cmd) - 1, file);
+    fclose(file);
+    cmd[len] = '\0';  // cmdline is a list of NUL terminated arguments, take the first one
+    const char *exe = strrchr(cmd, '/');
+    exe = exe ? exe + 1 : cmd;
+    if (len > 0 && strcmp(exe, base) == 0) {
+      lua_pushinteger(L, pid);
+      lua_rawseti(L, -2, ++count);
+    }
+  }
+  closedir(proc);
+  return 1;
+}
+
+// process.kill(pid[, signal])
+// Sends signal (SIGTERM by default) to the process, returns true on success.
+int process_kill(lua_State *L) {
+  const pid_t pid = luaL_checkinteger(L, 1);
+  const int sig = luaL_optinteger(L, 2, SIGTERM);
+  lua_pushboolean(L, pid > 0 && kill(pid, sig) == 0);
+  return 1;
+}
+
+// process.sleep(seconds)
+// Blocks ATF for the given (possibly fractional) number of seconds.
+int process_sleep(lua_State *L) {
+  const lua_Number seconds = luaL_checknumber(L, 1);
+  if (seconds <= 0) {
+    return 0;
+  }
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(seconds);
+  ts.tv_nsec = static_cast<long>((seconds - ts.tv_sec) * 1e9);
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+  return 0;
+}
+
+Process* check_process(lua_State *L) {
+  return *static_cast<Process**>(luaL_checkudata(L, 1, "process.Process"));
+}
+
+// proc:pid()
+int process_pid(lua_State *L) {
+  lua_pushinteger(L, check_process(L)->pid());
+  return 1;
+}
+
+// proc:running()
+// Non-blocking status check.
+int process_running(lua_State *L) {
+  lua_pushboolean(L, check_process(L)->isRunning());
+  return 1;
+}
+
+// proc:exitCode()
+// Returns exit code and terminating signal of the finished process or nil.
+// Exit code of an attached process is -1 as it can't be known.
+int process_exit_code(lua_State *L) {
+  Process *process = check_process(L);
+  if (process->isRunning()) {
+    lua_pushnil(L);
+    return 1;
+  }
+  lua_pushinteger(L, process->exitCode());
+  lua_pushinteger(L, process->exitSignal());
+  return 2;
+}
+
+// proc:kill([signal])
+// Sends signal (SIGTERM by default) to the running process, returns true on success.
+int process_signal(lua_State *L) {
+  Process *process = check_process(L);
+  const int sig = luaL_optinteger(L, 2, SIGTERM);
+  lua_pushboolean(L, process->isRunning() && kill(process->pid(), sig) == 0);
+  return 1;
+}
+
+// proc:wait([msec])
+// Blocks until the process finishes or msec expires, returns true if it has finished.
+int process_wait(lua_State *L) {
+  Process *process = check_process(L);
+  const int msecs = luaL_optinteger(L, 2, -1);
+  lua_pushboolean(L, process->waitForFinished(msecs));
+  return 1;
+}
+
+int process_delete(lua_State *L) {
+  delete check_process(L);
+  return 0;
+}
+}  // anonymous namespace
+
+int luaopen_process(lua_State *L) {
+  luaL_newmetatable(L, "process.Process");
+  lua_newtable(L);
+  luaL_Reg process_methods[] = {
+    { "pid", &process_pid },
+    { "running", &process_running },
+    { "exitCode", &process_exit_code },
+    { "kill", &process_signal },
+    { "wait", &process_wait },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, process_methods, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, &process_delete);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+
+  luaL_Reg process_functions[] = {
+    { "spawn", &process_spawn },
+    { "attach", &process_attach },
+    { "find", &process_find },
+    { "kill", &process_kill },
+    { "sleep", &process_sleep },
+    { NULL, NULL }
+  };
+  luaL_newlib(L, process_functions);
+  const struct { const char *name; int value; } kSignals[] = {
+    { "SIGINT", SIGINT },
+    { "SIGTERM", SIGTERM },
+    { "SIGKILL", SIGKILL },
+    { "SIGABRT", SIGABRT }
+  };
+  for (auto& sig : kSignals) {
+    lua_pushinteger(L, sig.value);
+    lua_setfield(L, -2, sig.name);
+  }
+  return 1;
+}
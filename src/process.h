@@ -0,0 +1,44 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <sys/types.h>
+
+// Process started by process.spawn or attached by pid.
+// Exit is detected with pidfd when the kernel supports it, by periodic polling otherwise.
+class Process : public QObject {
+  Q_OBJECT
+ public:
+  Process(pid_t pid, int pidfd, bool child, QObject *parent = 0);
+  ~Process();
+  pid_t pid() const;
+  // Non-blocking check, a finished child is reaped
+  bool isRunning();
+  // Waits up to msecs (forever if negative) for the process to finish
+  bool waitForFinished(int msecs);
+  int exitCode() const;
+  int exitSignal() const;
+ signals:
+  void finished(int exitCode, int exitSignal);
+ private slots:
+  void check();
+ private:
+  bool checkFinished();
+
+  pid_t pid_;
+  int pidfd_;
+  bool child_;
+  bool running_;
+  int exitCode_;
+  int exitSignal_;
+  QSocketNotifier *notifier_;
+  QTimer pollTimer_;
+};
+
+int luaopen_process(lua_State *L);
@@ -0,0 +1,385 @@
+#include "protocol.h"
+#include "network.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+const size_t kProtocolHeaderSize = 12;
+const size_t kInitialBufferCapacity = 4096;
+
+const int kFirstFrame = 0x02;
+const int kConsecutiveFrame = 0x03;
+const int kLastFrame = 0x00;
+
+const int kFirstFrameDataSize = 8;
+// Total size announced by a first frame comes from the wire, so memory reserved up front
+// is limited to 64 frames of the largest size (protocol v3+); the rest grows on demand
+const quint32 kMaxReservedMessageSize = 64 * 131084;
+
+quint32 readUint32(const unsigned char *p) {
+  return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | quint32(p[3]);
+}
+
+void writeUint32(char *p, quint32 value) {
+  p[0] = static_cast<char>(value >> 24);
+  p[1] = static_cast<char>(value >> 16);
+  p[2] = static_cast<char>(value >> 8);
+  p[3] = static_cast<char>(value);
+}
+
+// Growable ring buffer for the raw transport stream.
+// Storage is only allocated on first append and capacity is always a power of two.
+class RingBuffer {
+ public:
+  RingBuffer() : head_(0), size_(0) { }
+
+  size_t size() const { return size_; }
+
+  void append(const char *data, size_t len) {
+    if (len == 0) {
+      return;
+    }
+    if (size_ + len > data_.size()) {
+      grow(size_ + len);
+    }
+    size_t tail = (head_ + size_) & mask();
+    size_t first = std::min(len, data_.size() - tail);
+    memcpy(&data_[tail], data, first);
+    memcpy(&data_[0], data + first, len - first);
+    size_ += len;
+  }
+
+  void peek(size_t offset, char *out, size_t len) const {
+    size_t start = (head_ + offset) & mask();
+    size_t first = std::min(len, data_.size() - start);
+    memcpy(out, &data_[start], first);
+    memcpy(out + first, &data_[0], len - first);
+  }
+
+  // Pointer to 'len' bytes at 'offset' if they are not split by the end of storage
+  const char* contiguous(size_t offset, size_t len) const {
+    size_t start = (head_ + offset) & mask();
+    return start + len <= data_.size() ? &data_[start] : nullptr;
+  }
+
+  void consume(size_t len) {
+    head_ = (head_ + len) & mask();
+    size_ -= len;
+    if (size_ == 0) {
+      head_ = 0;
+    }
+  }
+
+ private:
+  size_t mask() const { return data_.size() - 1; }
+
+  void grow(size_t required) {
+    size_t capacity = data_.empty() ? kInitialBufferCapacity : data_.size();
+    while (capacity < required) {
+      capacity <<= 1;
+    }
+    std::vector<char> data(capacity);
+    if (size_ > 0) {
+      peek(0, &data[0], size_);
+    }
+    data_.swap(data);
+    head_ = 0;
+  }
+
+  std::vector<char> data_;
+  size_t head_;
+  size_t size_;
+};
+
+struct PendingMessage {
+  QByteArray data;
+  lua_Number size = 0;
+};
+
+struct Parser {
+  RingBuffer buffer;
+  // Multiframe messages being reassembled, keyed by (sessionId << 32 | messageId)
+  QHash<quint64, PendingMessage> pending;
+};
+
+Parser* check_parser(lua_State *L, int idx) {
+  return *static_cast<Parser**>(luaL_checkudata(L, idx, "protocol.Parser"));
+}
+
+void set_number_field(lua_State *L, const char *name, lua_Number value) {
+  lua_pushnumber(L, value);
+  lua_setfield(L, -2, name);
+}
+
+// Pushes table representation of the frame which starts at the head of the buffer
+void push_frame(lua_State *L, const RingBuffer &buffer, const unsigned char *header, size_t size) {
+  lua_createtable(L, 0, 11);
+  lua_newtable(L);
+  lua_setfield(L, -2, "_technical");
+  set_number_field(L, "version", (header[0] & 0xf0) >> 4);
+  set_number_field(L, "frameType", header[0] & 0x07);
+  lua_pushboolean(L, (header[0] & 0x08) == 0x08);
+  lua_setfield(L, -2, "encryption");
+  set_number_field(L, "serviceType", header[1]);
+  set_number_field(L, "frameInfo", header[2]);
+  set_number_field(L, "sessionId", header[3]);
+  set_number_field(L, "size", size);
+  set_number_field(L, "messageId", readUint32(header + 8));
+
+  const char *payload = buffer.contiguous(kProtocolHeaderSize, size);
+  if (payload) {
+    lua_pushlstring(L, payload, size);
+  } else {
+    luaL_Buffer b;
+    char *out = luaL_buffinitsize(L, &b, size);
+    buffer.peek(kProtocolHeaderSize, out, size);
+    luaL_pushresultsize(&b, size);
+  }
+  lua_setfield(L, -2, "binaryData");
+}
+
+int protocol_parser(lua_State *L) {
+  Parser **p = static_cast<Parser**>(lua_newuserdata(L, sizeof(Parser*)));
+  *p = new Parser();
+  luaL_getmetatable(L, "protocol.Parser");
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+int parser_parse(lua_State *L) {
+  Parser *parser = check_parser(L, 1);
+  const QByteArray *input = network_to_buffer(L, 2);
+  if (input) {
+    parser->buffer.append(input->constData(), input->size());
+  } else {
+    size_t size;
+    const char *data = luaL_checklstring(L, 2, &size);
+    parser->buffer.append(data, size);
+  }
+
+  lua_newtable(L);
+  int i = 0;
+  unsigned char header[kProtocolHeaderSize];
+  while (parser->buffer.size() >= kProtocolHeaderSize) {
+    parser->buffer.peek(0, reinterpret_cast<char*>(header), kProtocolHeaderSize);
+    size_t frameSize = readUint32(header + 4);
+    if (parser->buffer.size() < kProtocolHeaderSize + frameSize) {
+      break;
+    }
+    push_frame(L, parser->buffer, header, frameSize);
+    lua_rawseti(L, -2, ++i);
+    parser->buffer.consume(kProtocolHeaderSize + frameSize);
+  }
+  return 1;
+}
+
+int parser_assemble(lua_State *L) {
+  Parser *parser = check_parser(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+  lua_getfield(L, 2, "frameType");
+  lua_getfield(L, 2, "frameInfo");
+  lua_getfield(L, 2, "sessionId");
+  lua_getfield(L, 2, "messageId");
+  lua_getfield(L, 2, "size");
+  const int frameType = lua_tointeger(L, -5);
+  const int frameInfo = lua_tointeger(L, -4);
+  const quint64 key = (quint64(lua_tointeger(L, -3)) << 32)
+      | static_cast<quint32>(static_cast<qint64>(lua_tonumber(L, -2)));
+  const lua_Number frameSize = lua_tonumber(L, -1);
+  lua_pop(L, 5);
+
+  lua_getfield(L, 2, "binaryData");
+  size_t size = 0;
+  const char *data = lua_tolstring(L, -1, &size);
+  if (!data) {
+    return luaL_error(L, "assemble: frame must contain binaryData");
+  }
+
+  if (frameType == kFirstFrame) {
+    PendingMessage &message = parser->pending[key];
+    message.data.clear();
+    // First frame payload contains total data size followed by count of frames
+    if (size >= 4) {
+      const quint32 total = readUint32(reinterpret_cast<const unsigned char*>(data));
+      message.data.reserve(static_cast<int>(qMin(total, kMaxReservedMessageSize)));
+    }
+    message.size = frameSize;
+    lua_pushboolean(L, 0);
+    return 1;
+  }
+  if (frameType != kConsecutiveFrame) {
+    return luaL_argerror(L, 2, "first or consecutive frame expected");
+  }
+
+  PendingMessage &message = parser->pending[key];
+  message.data.append(data, size);
+  message.size += frameSize;
+  if (frameInfo != kLastFrame) {
+    lua_pushboolean(L, 0);
+    return 1;
+  }
+
+  lua_pushlstring(L, message.data.constData(), message.data.size());
+  lua_setfield(L, 2, "binaryData");
+  lua_pushnumber(L, message.size);
+  lua_setfield(L, 2, "size");
+  parser->pending.remove(key);
+  lua_pushboolean(L, 1);
+  return 1;
+}
+
+int parser_delete(lua_State *L) {
+  delete check_parser(L, 1);
+  return 0;
+}
+
+// Header fields shared by all frames of a composed message
+struct FrameHeader {
+  int version;
+  bool encryption;
+  int frameType;
+  int serviceType;
+  int frameInfo;
+  int sessionId;
+  quint32 messageId;
+};
+
+int get_int_field(lua_State *L, int idx, const char *name) {
+  lua_getfield(L, idx, name);
+  const int value = lua_tointeger(L, -1);
+  lua_pop(L, 1);
+  return value;
+}
+
+// Writes frame header followed by 'size' bytes of 'data', returns position after the frame
+char* write_frame(char *out, const FrameHeader &header, int frameType, int frameInfo,
+                  bool encryption, const char *data, quint32 size) {
+  out[0] = static_cast<char>(((header.version & 0x0f) << 4) | (encryption ? 0x08 : 0) | (frameType & 0x07));
+  out[1] = static_cast<char>(header.serviceType);
+  out[2] = static_cast<char>(frameInfo);
+  out[3] = static_cast<char>(header.sessionId);
+  writeUint32(out + 4, size);
+  writeUint32(out + 8, header.messageId);
+  memcpy(out + kProtocolHeaderSize, data, size);
+  return out + kProtocolHeaderSize + size;
+}
+
+// Writes consecutive frame number 'index' (0-based) out of 'count'
+char* write_consecutive_frame(char *out, const FrameHeader &header, const char *data,
+                              size_t size, size_t maxPayload, size_t index, size_t count) {
+  const size_t offset = index * maxPayload;
+  const size_t partSize = std::min(maxPayload, size - offset);
+  const int frameInfo = index + 1 == count ? kLastFrame : static_cast<int>(index % 255) + 1;
+  return write_frame(out, header, kConsecutiveFrame, frameInfo, header.encryption,
+                     data + offset, static_cast<quint32>(partSize));
+}
+
+// protocol.compose(message, frameSize[, contiguous])
+// Splits message into frames not exceeding frameSize. Returns array of frame strings
+// or, if 'contiguous' is true, a single string with all frames.
+int protocol_compose(lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  const lua_Integer frameSize = luaL_checkinteger(L, 2);
+  const bool contiguous = lua_toboolean(L, 3);
+  luaL_argcheck(L, frameSize > static_cast<lua_Integer>(kProtocolHeaderSize), 2, "frame size is too small");
+  const size_t maxPayload = frameSize - kProtocolHeaderSize;
+
+  FrameHeader header;
+  header.version = get_int_field(L, 1, "version");
+  header.frameType = get_int_field(L, 1, "frameType");
+  header.serviceType = get_int_field(L, 1, "serviceType");
+  header.frameInfo = get_int_field(L, 1, "frameInfo");
+  header.sessionId = get_int_field(L, 1, "sessionId");
+  lua_getfield(L, 1, "encryption");
+  header.encryption = lua_toboolean(L, -1);
+  lua_getfield(L, 1, "messageId");
+  header.messageId = static_cast<quint32>(static_cast<qint64>(lua_tonumber(L, -1)));
+  lua_pop(L, 2);
+
+  // binaryData string stays on the stack while frames are written
+  lua_getfield(L, 1, "binaryData");
+  size_t size = 0;
+  const char *data = "";
+  if (!lua_isnil(L, -1)) {
+    data = lua_tolstring(L, -1, &size);
+    if (!data) {
+      return luaL_error(L, "compose: binaryData must be a string");
+    }
+  }
+
+  luaL_Buffer b;
+  if (size <= maxPayload) {
+    char *out = luaL_buffinitsize(L, &b, kProtocolHeaderSize + size);
+    write_frame(out, header, header.frameType, header.frameInfo, header.encryption,
+                data, static_cast<quint32>(size));
+    luaL_pushresultsize(&b, kProtocolHeaderSize + size);
+    if (!contiguous) {
+      lua_createtable(L, 1, 0);
+      lua_insert(L, -2);
+      lua_rawseti(L, -2, 1);
+    }
+    return 1;
+  }
+
+  const size_t count = (size + maxPayload - 1) / maxPayload;
+  char firstFrameData[kFirstFrameDataSize];
+  writeUint32(firstFrameData, static_cast<quint32>(size));
+  writeUint32(firstFrameData + 4, static_cast<quint32>(count));
+  // First frame has to be always unencrypted
+  const size_t firstFrameSize = kProtocolHeaderSize + kFirstFrameDataSize;
+
+  if (contiguous) {
+    const size_t total = firstFrameSize + count * kProtocolHeaderSize + size;
+    char *out = luaL_buffinitsize(L, &b, total);
+    char *pos = write_frame(out, header, kFirstFrame, 0, false, firstFrameData, kFirstFrameDataSize);
+    for (size_t i = 0; i < count; ++i) {
+      pos = write_consecutive_frame(pos, header, data, size, maxPayload, i, count);
+    }
+    luaL_pushresultsize(&b, total);
+    return 1;
+  }
+
+  lua_createtable(L, count + 1, 0);
+  const int result = lua_gettop(L);
+  char *out = luaL_buffinitsize(L, &b, firstFrameSize);
+  write_frame(out, header, kFirstFrame, 0, false, firstFrameData, kFirstFrameDataSize);
+  luaL_pushresultsize(&b, firstFrameSize);
+  lua_rawseti(L, result, 1);
+  for (size_t i = 0; i < count; ++i) {
+    const size_t partSize = std::min(maxPayload, size - i * maxPayload);
+    out = luaL_buffinitsize(L, &b, kProtocolHeaderSize + partSize);
+    write_consecutive_frame(out, header, data, size, maxPayload, i, count);
+    luaL_pushresultsize(&b, kProtocolHeaderSize + partSize);
+    lua_rawseti(L, result, i + 2);
+  }
+  return 1;
+}
+}  // anonymous namespace
+
+int luaopen_protocol(lua_State *L) {
+  luaL_newmetatable(L, "protocol.Parser");
+  lua_newtable(L);
+  luaL_Reg parser_functions[] = {
+    { "parse", &parser_parse },
+    { "assemble", &parser_assemble },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, parser_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, &parser_delete);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+
+  luaL_Reg protocol_functions[] = {
+    { "Parser", &protocol_parser },
+    { "compose", &protocol_compose },
+    { NULL, NULL }
+  };
+  luaL_newlib(L, protocol_functions);
+  return 1;
+}
@@ -2,6 +2,7 @@
 #include "qtdynamic.h"
 #include <QObject>
 #include <QDebug>
+#include <cstring>
 #line 5 "main.nw"
 extern "C" {
 #include <lua5.2/lua.h>
@@ -9,9 +10,28 @@ extern "C" {
 #include <lua5.2/lauxlib.h>
 }
 #line 70 "dynamic_object.nw"
+int DynamicObject::liveConnections_ = 0;
+
 DynamicObject::DynamicObject(QObject *parent)
   : QObject(parent) { }
 
+DynamicObject::~DynamicObject()
+{
+  // Watches are dropped first: this object may be a sender of its own slots
+  for (auto &watch : senderWatches) {
+    QObject::disconnect(watch);
+  }
+  for (int i = 0; i < slotList.size(); ++i) {
+    liveConnections_ -= slotConnections[i];
+    delete slotList[i];
+  }
+}
+
+int DynamicObject::liveConnections()
+{
+  return liveConnections_;
+}
+
 static QList<QByteArray> typesFromString(const char *str, const char *end)
 {
   QList<QByteArray> result;
@@ -51,8 +71,18 @@ static int *queuedConnectionTypes(const QList<QByteArray> &typeNames)
     return types;
 }
 
+// Argument types are needed only when the call may be queued
+static int *connectionArgumentTypes(Qt::ConnectionType type, const QByteArray &signature)
+{
+  if (type == Qt::DirectConnection) {
+    return 0;
+  }
+  return queuedConnectionTypes(typesFromString(signature.constData() + signature.indexOf('(') + 1,
+                                               signature.constData() + signature.indexOf(')')));
+}
+
 bool DynamicObject::connectDynamicSlot(QObject *obj, const char *signal, const char *slot,
-    DynamicSlot *s)
+    DynamicSlot *s, Qt::ConnectionType type)
 {
   
 #line 189 "dynamic_object.nw"
@@ -60,6 +90,7 @@ QByteArray theSignal = QMetaObject::normalizedSignature(signal);
 QByteArray theSlot   = QMetaObject::normalizedSignature(slot);
 if (!QMetaObject::checkConnectArgs(theSignal, theSlot)) {
   qWarning() << "Cannot connect signal" << theSignal << "to slot" << theSlot;
+  delete s;
   return false;
 }
 
@@ -67,24 +98,23 @@ if (!QMetaObject::checkConnectArgs(theSignal, theSlot)) {
   int signalId = obj->metaObject()->indexOfSignal(theSignal);
   if (signalId < 0) {
     qWarning() << "No such signal " << theSignal;
+    delete s;
     return false;
   }
 
-  int slotId = slotIndices.value(theSlot, -1);
-  if (slotId < 0) {
-    slotId = slotList.size();
-    slotIndices[theSlot] = slotId;
-    slotList.append(s);
-  }
-
-  return QMetaObject::connect(obj, signalId,
+  int slotId = addSlot(theSlot, s);
+  if (!QMetaObject::connect(obj, signalId,
           this, slotId + metaObject()->methodCount(),
-          Qt::QueuedConnection,
-          queuedConnectionTypes(typesFromString(theSlot.constData() + theSlot.indexOf('(') + 1,
-                                                theSlot.constData() + theSlot.indexOf(')'))));
+          type, connectionArgumentTypes(type, theSlot))) {
+    releaseSlot(slotId, 0);
+    return false;
+  }
+  addSlotConnection(obj, signalId, slotId);
+  return true;
 }
 
-bool DynamicObject::connectDynamicSignal(const char *signal, QObject *obj, const char *slot)
+bool DynamicObject::connectDynamicSignal(const char *signal, QObject *obj, const char *slot,
+    Qt::ConnectionType type)
 {
   
 #line 189 "dynamic_object.nw"
@@ -102,15 +132,9 @@ if (!QMetaObject::checkConnectArgs(theSignal, theSlot)) {
     return false;
   }
 
-  int signalId = signalIndices.value(theSignal, -1);
-  if (signalId < 0) {
-      signalId = signalIndices.size();
-      signalIndices[theSignal] = signalId;
-  }
+  int signalId = dynamicSignalIndex(theSignal);
   return QMetaObject::connect(this, signalId + metaObject()->methodCount(), obj, slotId,
-    Qt::QueuedConnection,
-    queuedConnectionTypes(typesFromString(theSignal.constData() + theSignal.indexOf('(') + 1,
-                                          theSignal.constData() + theSignal.indexOf(')'))));
+    type, connectionArgumentTypes(type, theSignal));
 }
 
 bool DynamicObject::connectDynamicSignalToDynamicSlot(
@@ -118,7 +142,8 @@ bool DynamicObject::connectDynamicSignalToDynamicSlot(
   const char *signal,
   DynamicObject* receiver,
   const char *slot,
-  DynamicSlot *s)
+  DynamicSlot *s,
+  Qt::ConnectionType type)
 {
   
 #line 189 "dynamic_object.nw"
@@ -126,30 +151,130 @@ QByteArray theSignal = QMetaObject::normalizedSignature(signal);
 QByteArray theSlot   = QMetaObject::normalizedSignature(slot);
 if (!QMetaObject::checkConnectArgs(theSignal, theSlot)) {
   qWarning() << "Cannot connect signal" << theSignal << "to slot" << theSlot;
+  delete s;
   return false;
 }
 
 #line 167 "dynamic_object.nw"
+  int signalId = sender->dynamicSignalIndex(theSignal);
+
+  signalId += sender->metaObject()->methodCount();
+  int slotId = receiver->addSlot(theSlot, s);
+  if (!QMetaObject::connect(sender,
+    signalId,
+    receiver,
+    slotId + receiver->metaObject()->methodCount(),
+    type, connectionArgumentTypes(type, theSignal))) {
+    receiver->releaseSlot(slotId, 0);
+    return false;
+  }
+  receiver->addSlotConnection(sender, signalId, slotId);
+  return true;
+}
+
+bool DynamicObject::disconnectDynamicSignal(const char *signal, QObject *obj, const char *slot)
+{
+  QByteArray theSignal = QMetaObject::normalizedSignature(signal);
+  QByteArray theSlot   = QMetaObject::normalizedSignature(slot);
+  int signalId = signalIndices.value(theSignal, -1);
+  int slotId = obj->metaObject()->indexOfSlot(theSlot);
+  if (signalId < 0 || slotId < 0) {
+    return false;
+  }
+  return QMetaObject::disconnect(this, signalId + metaObject()->methodCount(), obj, slotId);
+}
+
+bool DynamicObject::disconnectDynamicSlot(QObject *obj, const char *signal, const char *slot)
+{
+  QByteArray theSignal = QMetaObject::normalizedSignature(signal);
+  int signalId = obj->metaObject()->indexOfSignal(theSignal);
+  if (signalId < 0) {
+    return false;
+  }
+  return removeSlotConnections(obj, signalId, QMetaObject::normalizedSignature(slot));
+}
+
+bool DynamicObject::disconnectDynamicSignalFromDynamicSlot(
+  DynamicObject* sender,
+  const char *signal,
+  DynamicObject* receiver,
+  const char *slot)
+{
+  QByteArray theSignal = QMetaObject::normalizedSignature(signal);
   int signalId = sender->signalIndices.value(theSignal, -1);
   if (signalId < 0) {
-      signalId = sender->signalIndices.size();
-      sender->signalIndices[theSignal] = signalId;
+    return false;
   }
+  return receiver->removeSlotConnections(sender,
+    signalId + sender->metaObject()->methodCount(),
+    QMetaObject::normalizedSignature(slot));
+}
 
-  int slotId = receiver->slotIndices.value(theSlot, -1);
+int DynamicObject::addSlot(const QByteArray &theSlot, DynamicSlot *s)
+{
+  int slotId = slotIndices.value(theSlot, -1);
   if (slotId < 0) {
-    slotId = receiver->slotList.size();
-    receiver->slotIndices[theSlot] = slotId;
-    receiver->slotList.append(s);
+    slotId = slotList.size();
+    slotIndices[theSlot] = slotId;
+    slotList.append(s);
+    slotConnections.append(0);
+  } else {
+    delete s;  // The slot is bound already
   }
+  return slotId;
+}
 
-  return QMetaObject::connect(sender,
-    signalId + sender->metaObject()->methodCount(),
-    receiver,
-    slotId + receiver->metaObject()->methodCount(),
-    Qt::QueuedConnection,
-    queuedConnectionTypes(typesFromString(theSignal.constData() + theSignal.indexOf('(') + 1,
-                                          theSignal.constData() + theSignal.indexOf(')'))));
+void DynamicObject::addSlotConnection(QObject *obj, int signalId, int slotId)
+{
+  ++slotConnections[slotId];
+  ++liveConnections_;
+  // Qt drops connections of a deleted sender silently, so the slot bookkeeping follows it
+  if (!senderWatches.contains(obj)) {
+    senderWatches[obj] = connect(obj, &QObject::destroyed, this,
+        [this](QObject *o) { senderDestroyed(o); });
+  }
+  senderSlots.insert(obj, qMakePair(signalId, slotId));
+}
+
+bool DynamicObject::removeSlotConnections(QObject *obj, int signalId, const QByteArray &theSlot)
+{
+  int slotId = slotIndices.value(theSlot, -1);
+  if (slotId < 0) {
+    return false;
+  }
+  if (!QMetaObject::disconnect(obj, signalId, this, slotId + metaObject()->methodCount())) {
+    return false;
+  }
+  // Qt removes duplicated connections all at once
+  int removed = senderSlots.remove(obj, qMakePair(signalId, slotId));
+  if (!senderSlots.contains(obj)) {
+    QObject::disconnect(senderWatches.take(obj));
+  }
+  releaseSlot(slotId, removed);
+  return true;
+}
+
+void DynamicObject::releaseSlot(int slotId, int connections)
+{
+  slotConnections[slotId] -= connections;
+  liveConnections_ -= connections;
+  if (slotConnections[slotId] > 0 || !slotList[slotId]) {
+    return;
+  }
+  // The id is not reused: queued calls of the released slot may still be pending
+  slotIndices.remove(slotIndices.key(slotId));
+  delete slotList[slotId];
+  slotList[slotId] = NULL;
+}
+
+void DynamicObject::senderDestroyed(QObject *obj)
+{
+  auto connections = senderSlots.values(obj);
+  senderSlots.remove(obj);
+  senderWatches.remove(obj);
+  for (auto &c : connections) {
+    releaseSlot(c.second, 1);
+  }
 }
 #line 196 "dynamic_object.nw"
 int DynamicObject::qt_metacall(QMetaObject::Call c, int id, void **arguments)
@@ -159,50 +284,76 @@ int DynamicObject::qt_metacall(QMetaObject::Call c, int id, void **arguments)
       return id;
   Q_ASSERT(id < slotList.size());
 
-  slotList[id]->call(sender(), arguments);
+  // Null for a slot released by disconnection while its call was queued
+  if (slotList[id]) {
+    slotList[id]->call(sender(), arguments);
+  }
   return -1;
 }
 
-bool DynamicObject::emitDynamicSignal(const char *signal, void **arguments)
+int DynamicObject::dynamicSignalIndex(const QByteArray &signature)
 {
-  QByteArray theSignal = QMetaObject::normalizedSignature(signal);
-  int signalId = signalIndices.value(theSignal, -1);
-  if (signalId >= 0) {
-      QMetaObject::activate(this, metaObject(), signalId + metaObject()->methodCount(),
-          arguments);
-      return true;
-  } else {
-      return false;
+  int signalId = signalIndices.value(signature, -1);
+  if (signalId < 0) {
+      signalId = signalIndices.size();
+      signalIndices[signature] = signalId;
   }
+  return signalId;
+}
+
+void DynamicObject::emitDynamicSignal(int signalIndex, void **arguments)
+{
+  QMetaObject::activate(this, metaObject(), signalIndex + metaObject()->methodCount(),
+      arguments);
+}
+
+int DynamicSlot::liveCount_ = 0;
+
+int DynamicSlot::liveCount()
+{
+  return liveCount_;
 }
 
 DynamicSlot::DynamicSlot(lua_State *L, int objidx, const char *signature)
   : lua_state(L),
     objidx_(objidx)
 {
+  ++liveCount_;
   QByteArray theSignal = QMetaObject::normalizedSignature(signature);
   marshallers_ = get_marshalling_list(theSignal);
-  QByteArray slotName = signature;
-  slot_ = QString(QByteArray(slotName, slotName.indexOf('(')));
+  // The name is kept as a Lua string, so a call doesn't convert or intern it
+  const char *paren = strchr(signature, '(');
+  lua_pushlstring(L, signature, paren ? paren - signature : strlen(signature));
+  nameRef_ = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+DynamicSlot::~DynamicSlot()
+{
+  --liveCount_;
+  luaL_unref(lua_state, LUA_REGISTRYINDEX, nameRef_);
+  luaL_unref(lua_state, LUA_REGISTRYINDEX, objidx_);
 }
 
 void DynamicSlot::call(QObject *sender, void **arguments)
 {
   (void)sender;
-  lua_rawgeti(lua_state, LUA_REGISTRYINDEX, objidx_);
-  lua_getfield(lua_state, -1, slot_.toUtf8().constData());
-  if (lua_isfunction(lua_state, -1)) {
-    lua_pushnil(lua_state);
-    lua_copy(lua_state, -3, -1);
+  // The slot handler may disconnect and so delete this slot, only locals are used after the call
+  lua_State *L = lua_state;
+  lua_rawgeti(L, LUA_REGISTRYINDEX, objidx_);
+  lua_rawgeti(L, LUA_REGISTRYINDEX, nameRef_);
+  lua_gettable(L, -2);
+  if (lua_isfunction(L, -1)) {
+    lua_pushnil(L);
+    lua_copy(L, -3, -1);
     ++arguments;  // skip return value
     int argc = 1;
     for (auto m : marshallers_) {
-      m->Unmarshal(*arguments++, lua_state);
+      m->Unmarshal(*arguments++, L);
       ++argc;
     }
-    lua_call(lua_state, argc, 0);
+    lua_call(L, argc, 0);
   } else {
-    lua_pop(lua_state, 1); // Remove slot from stack
+    lua_pop(L, 1); // Remove slot from stack
   }
-  lua_pop(lua_state, 1);   // Remove object from stack
+  lua_pop(L, 1);   // Remove object from stack
 }
@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QMetaObject>
 #include <QHash>
+#include <QPair>
 #include <QByteArray>
 #line 5 "main.nw"
 extern "C" {
@@ -17,29 +18,62 @@ class DynamicSlot
 {
  public:
   DynamicSlot(lua_State *L, int objidx, const char* signature);
+  ~DynamicSlot();
   void call(QObject *sender, void **arguments);
+  // Number of slot objects alive, each one pins its receiver in the registry
+  static int liveCount();
  private:
+  static int liveCount_;
   lua_State *lua_state;
   QList<Marshaller*> marshallers_;
   int objidx_;
-  QString slot_;
+  int nameRef_;  // Registry index of the slot name string
 };
 #line 44 "dynamic_object.nw"
 class DynamicObject : public QObject {
  public:
   DynamicObject(QObject *parent);
+  ~DynamicObject();
   virtual int qt_metacall(QMetaObject::Call c, int id, void **arguments);
-  bool emitDynamicSignal(const char *signal, void **arguments);
-  bool connectDynamicSignal(const char *signal, QObject *obj, const char *slot);
-  bool connectDynamicSlot(QObject *obj, const char *signal, const char *slot, DynamicSlot *s);
+  // Returns index of the dynamic signal, registers the signal if it is new
+  int dynamicSignalIndex(const QByteArray &signature);
+  void emitDynamicSignal(int signalIndex, void **arguments);
+  // Connections are queued by default, a direct one calls the slot from the emitter
+  bool connectDynamicSignal(const char *signal, QObject *obj, const char *slot,
+    Qt::ConnectionType type = Qt::QueuedConnection);
+  // The receiver takes the ownership of the slot s, it is deleted if the connection fails
+  bool connectDynamicSlot(QObject *obj, const char *signal, const char *slot, DynamicSlot *s,
+    Qt::ConnectionType type = Qt::QueuedConnection);
   static bool connectDynamicSignalToDynamicSlot(
     DynamicObject* sender,
     const char *signal,
     DynamicObject* receiver,
     const char *slot,
-    DynamicSlot *s);
+    DynamicSlot *s,
+    Qt::ConnectionType type = Qt::QueuedConnection);
+  // Disconnection frees the slot and its registry references
+  // once no connections to it are left
+  bool disconnectDynamicSignal(const char *signal, QObject *obj, const char *slot);
+  bool disconnectDynamicSlot(QObject *obj, const char *signal, const char *slot);
+  static bool disconnectDynamicSignalFromDynamicSlot(
+    DynamicObject* sender,
+    const char *signal,
+    DynamicObject* receiver,
+    const char *slot);
+  // Number of connections to dynamic slots of all dynamic objects
+  static int liveConnections();
  private:
+  int addSlot(const QByteArray &theSlot, DynamicSlot *s);
+  void addSlotConnection(QObject *obj, int signalId, int slotId);
+  bool removeSlotConnections(QObject *obj, int signalId, const QByteArray &theSlot);
+  void releaseSlot(int slotId, int connections);
+  void senderDestroyed(QObject *obj);
+
   QHash<QByteArray, int> slotIndices;
-  QList<DynamicSlot *> slotList;
+  QList<DynamicSlot *> slotList;  // Released slots leave null entries
+  QList<int> slotConnections;     // Connection count for each slot
   QHash<QByteArray, int> signalIndices;
+  QMultiHash<QObject*, QPair<int, int> > senderSlots;  // Signal and slot ids of each sender
+  QHash<QObject*, QMetaObject::Connection> senderWatches;
+  static int liveConnections_;
 };
@@ -15,6 +15,7 @@ extern "C" {
 static int qtlua_createdynamic(lua_State *L);
 static int qtlua_connect(lua_State *L);
 static int qtlua_disconnect(lua_State *L);
+static int qtlua_connections(lua_State *L);
 static int dynamicTableId = 0; // Registry index of table used to mark dynamic userdata
 
 int luaopen_qt(lua_State *L) {
@@ -24,11 +25,29 @@ int luaopen_qt(lua_State *L) {
     { "dynamic", &qtlua_createdynamic },
     { "connect", &qtlua_connect },
     { "disconnect", &qtlua_disconnect },
+    { "connections", &qtlua_connections },
     { NULL, NULL }
   };
   luaL_newlib(L, functions);
+  // Connection types for qt.connect
+  lua_pushinteger(L, Qt::AutoConnection);
+  lua_setfield(L, -2, "AutoConnection");
+  lua_pushinteger(L, Qt::DirectConnection);
+  lua_setfield(L, -2, "DirectConnection");
+  lua_pushinteger(L, Qt::QueuedConnection);
+  lua_setfield(L, -2, "QueuedConnection");
   return 1;
 }
+bool qtlua_isdynamic(lua_State *L, int idx) {
+  if (lua_type(L, idx) != LUA_TUSERDATA) {
+    return false;
+  }
+  lua_getuservalue(L, idx);
+  lua_rawgeti(L, LUA_REGISTRYINDEX, dynamicTableId);
+  const bool result = lua_rawequal(L, -1, -2);
+  lua_pop(L, 2);
+  return result;
+}
 #line 43 "qtlua.nw"
 int qtlua_deletedynamic(lua_State *L) {
   DynamicObject * li = *static_cast<DynamicObject**>(lua_touserdata(L, 1));
@@ -62,15 +81,29 @@ int qtlua_createdynamic(lua_State *L) {
 // function creates them.
 static void get_index_table(lua_State *L, int idx);
 // Function emits the given signal of dynamic object.
-// It takes two  upvalues: signal name and list of argument types to marshal them properly
+// It takes two  upvalues: signal index and array of argument marshallers
 static int qtlua_emit_signal(lua_State *L);
+// Function binds emitter of the signal to the dynamic object at given index
+static void add_signal_emitter(lua_State *L, int idx, DynamicObject *sender, const char *signal);
+// Number of signal arguments marshalled without heap allocation
+static const int kStackArgs = 8;
 #line 86 "qtlua.nw"
+// qt.connect(sender, signal, receiver, slot[, type])
+// Type is one of qt.AutoConnection, qt.DirectConnection, qt.QueuedConnection.
+// Connections of dynamic objects are queued by default, a direct connection
+// calls the slot right from the emitter, which saves an event loop hop
+// for senders living in the same thread
 int qtlua_connect(lua_State *L) {
   QObject *sender, *receiver;
   bool senderIsDynamic = false;
   bool receiverIsDynamic = false;
   const char *signal = luaL_checkstring(L, 2);
   const char *slot = luaL_checkstring(L, 4);
+  const int type = luaL_optint(L, 5, -1);
+  luaL_argcheck(L, type == -1 || type == Qt::AutoConnection || type == Qt::DirectConnection ||
+                type == Qt::QueuedConnection, 5, "unknown connection type");
+  const Qt::ConnectionType dynamicType =
+    type == -1 ? Qt::QueuedConnection : static_cast<Qt::ConnectionType>(type);
 
   sender = *static_cast<QObject**>(lua_touserdata(L, 1));
   receiver = *static_cast<QObject**>(lua_touserdata(L, 3));
@@ -94,27 +127,7 @@ int qtlua_connect(lua_State *L) {
     DynamicObject * d_receiver = static_cast<DynamicObject*>(receiver);
 
     
-#line 134 "qtlua.nw"
-QByteArray theSignal = QMetaObject::normalizedSignature(signal);
-
-get_index_table(L, 1);
-// TODO: check if this function already is bound
-// Add signal emitter function
-//  Push signal name (upvalue 1)
-lua_pushstring(L, theSignal);
-//  Push marshallers table (upvalue 2)
-auto marshallers = get_marshalling_list(theSignal);
-lua_newtable(L);
-int i = 1;  // In Lua 1-based arrays are common
-for (auto m : marshallers) {
-  lua_pushlightuserdata(L, m);
-  lua_rawseti(L, -2, i++);
-}
-//  Push emitter
-lua_pushcclosure(L, &qtlua_emit_signal, 2);
-int idx = theSignal.indexOf('(');
-theSignal.truncate(idx);
-lua_setfield(L, -2, theSignal);
+add_signal_emitter(L, 1, d_sender, signal);
 #line 115 "qtlua.nw"
     
 #line 167 "qtlua.nw"
@@ -127,35 +140,16 @@ int objref = luaL_ref(L, LUA_REGISTRYINDEX);
       signal,
       d_receiver,
       slot,
-      new DynamicSlot(L, objref, slot));
+      new DynamicSlot(L, objref, slot),
+      dynamicType);
     lua_pushboolean(L, res);
   } else if (senderIsDynamic) {
 #line 129 "qtlua.nw"
     DynamicObject * d_sender = static_cast<DynamicObject*>(sender);
-    bool res = d_sender->connectDynamicSignal(signal, receiver, slot);
+    bool res = d_sender->connectDynamicSignal(signal, receiver, slot, dynamicType);
 
     
-#line 134 "qtlua.nw"
-QByteArray theSignal = QMetaObject::normalizedSignature(signal);
-
-get_index_table(L, 1);
-// TODO: check if this function already is bound
-// Add signal emitter function
-//  Push signal name (upvalue 1)
-lua_pushstring(L, theSignal);
-//  Push marshallers table (upvalue 2)
-auto marshallers = get_marshalling_list(theSignal);
-lua_newtable(L);
-int i = 1;  // In Lua 1-based arrays are common
-for (auto m : marshallers) {
-  lua_pushlightuserdata(L, m);
-  lua_rawseti(L, -2, i++);
-}
-//  Push emitter
-lua_pushcclosure(L, &qtlua_emit_signal, 2);
-int idx = theSignal.indexOf('(');
-theSignal.truncate(idx);
-lua_setfield(L, -2, theSignal);
+add_signal_emitter(L, 1, d_sender, signal);
 #line 155 "qtlua.nw"
     
     lua_pushboolean(L, res);
@@ -170,10 +164,11 @@ lua_copy(L, 3, -1);
 int objref = luaL_ref(L, LUA_REGISTRYINDEX);
 #line 172 "qtlua.nw"
     bool res = d_receiver->connectDynamicSlot(sender, signal, slot,
-        new DynamicSlot(L, objref, slot));
+        new DynamicSlot(L, objref, slot), dynamicType);
     lua_pushboolean(L, res);
   } else {
-    bool res = QObject::connect(sender, signal, receiver, slot);
+    bool res = QObject::connect(sender, signal, receiver, slot,
+        type == -1 ? Qt::AutoConnection : dynamicType);
     lua_pushboolean(L, res);
   }
   return 1;
@@ -198,35 +193,100 @@ void get_index_table(lua_State *L, int idx)
   lua_remove(L, -2);
 }
 #line 369 "qtlua.nw"
+void add_signal_emitter(lua_State *L, int idx, DynamicObject *sender, const char *signal)
+{
+  QByteArray theSignal = QMetaObject::normalizedSignature(signal);
+  get_index_table(L, idx);
+  // TODO: check if this function already is bound
+  //  Push signal index (upvalue 1)
+  lua_pushinteger(L, sender->dynamicSignalIndex(theSignal));
+  //  Push marshallers array (upvalue 2)
+  auto marshallers = get_marshalling_list(theSignal);
+  Marshaller **list = static_cast<Marshaller**>(
+    lua_newuserdata(L, sizeof(Marshaller*) * marshallers.size()));
+  for (int i = 0; i < marshallers.size(); ++i) {
+    list[i] = marshallers[i];
+  }
+  //  Push emitter
+  lua_pushcclosure(L, &qtlua_emit_signal, 2);
+  theSignal.truncate(theSignal.indexOf('('));
+  lua_setfield(L, -2, theSignal);
+  lua_pop(L, 1);
+}
+
 int qtlua_emit_signal(lua_State *L)
 {
   DynamicObject * li = *static_cast<DynamicObject**>(lua_touserdata(L, 1));
-  const char* theSignal = lua_tostring(L, lua_upvalueindex(1));
-  int mid = lua_upvalueindex(2); // Marshallers table pseudoindex
-  lua_len(L, mid);
-  int msize = lua_tointegerx(L, -1, NULL);
-  lua_pop(L, 1);
-  void *stackargs[8];
+  const int signalIndex = lua_tointegerx(L, lua_upvalueindex(1), NULL);
+  Marshaller **marshallers = static_cast<Marshaller**>(lua_touserdata(L, lua_upvalueindex(2)));
+  const int msize = lua_rawlen(L, lua_upvalueindex(2)) / sizeof(Marshaller*);
+  // Arguments are constructed in place, the heap is used only for long signatures
+  void *stackargs[kStackArgs + 1];
+  Marshaller::Storage stackstorage[kStackArgs];
   void **args = stackargs;
-  if (msize > 8) {
-    args = new void*[msize];
+  Marshaller::Storage *storage = stackstorage;
+  if (msize > kStackArgs) {
+    args = new void*[msize + 1];
+    storage = new Marshaller::Storage[msize];
   }
   args[0] = NULL;
-  for (int i = 1; i <= msize; ++i) {
-    lua_rawgeti(L, mid, i);
-    auto marshaller = static_cast<Marshaller*>(lua_touserdata(L, -1));
-    lua_pop(L, 1);
-    args[i] = marshaller->Marshal(L, i + 1);
+  for (int i = 0; i < msize; ++i) {
+    args[i + 1] = marshallers[i]->Marshal(L, i + 2, &storage[i]);
+  }
+  li->emitDynamicSignal(signalIndex, args);
+  for (int i = 0; i < msize; ++i) {
+    marshallers[i]->Dispose(args[i + 1]);
   }
-  li->emitDynamicSignal(theSignal, args);
   if (args != stackargs) {
     delete[] args;
+    delete[] storage;
   }
   return 0;
 }
 #line 397 "qtlua.nw"
+// qt.disconnect(sender, signal, receiver, slot)
+// Breaks the connection made by qt.connect, returns true if there was one.
+// A dynamic slot left without connections releases its receiver,
+// so the receiver can be collected
 int qtlua_disconnect(lua_State *L)
 {
-  (void)L;
-  return 0;
+  const char *signal = luaL_checkstring(L, 2);
+  const char *slot = luaL_checkstring(L, 4);
+  luaL_argcheck(L, lua_type(L, 1) == LUA_TUSERDATA, 1, "qt object expected");
+  luaL_argcheck(L, lua_type(L, 3) == LUA_TUSERDATA, 3, "qt object expected");
+  QObject *sender = *static_cast<QObject**>(lua_touserdata(L, 1));
+  QObject *receiver = *static_cast<QObject**>(lua_touserdata(L, 3));
+  if (!sender) {
+    return luaL_error(L, "disconnect: sender must be a qt object");
+  }
+  if (!receiver) {
+    return luaL_error(L, "disconnect: receiver must be a qt object");
+  }
+  const bool senderIsDynamic = qtlua_isdynamic(L, 1);
+  const bool receiverIsDynamic = qtlua_isdynamic(L, 3);
+
+  bool res;
+  if (senderIsDynamic && receiverIsDynamic) {
+    res = DynamicObject::disconnectDynamicSignalFromDynamicSlot(
+      static_cast<DynamicObject*>(sender), signal,
+      static_cast<DynamicObject*>(receiver), slot);
+  } else if (senderIsDynamic) {
+    res = static_cast<DynamicObject*>(sender)->disconnectDynamicSignal(signal, receiver, slot);
+  } else if (receiverIsDynamic) {
+    res = static_cast<DynamicObject*>(receiver)->disconnectDynamicSlot(sender, signal, slot);
+  } else {
+    res = QObject::disconnect(sender, signal, receiver, slot);
+  }
+  lua_pushboolean(L, res);
+  return 1;
+}
+
+// qt.connections()
+// Returns number of live connections to dynamic slots
+// and number of dynamic slots which hold their receivers
+int qtlua_connections(lua_State *L)
+{
+  lua_pushinteger(L, DynamicObject::liveConnections());
+  lua_pushinteger(L, DynamicSlot::liveCount());
+  return 2;
 }
@@ -8,3 +8,6 @@ extern "C" {
 }
 #line 11 "qtlua.nw"
 int luaopen_qt(lua_State *L);
+
+// Returns true if the value at idx is an object created by qt.dynamic()
+bool qtlua_isdynamic(lua_State *L, int idx);
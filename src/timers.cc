@@ -1,5 +1,146 @@
 #include "timers.h"
+#include <QByteArray>
+#include <QMetaObject>
 #include <QTimer>
+#include <iostream>
+
+CoroutineWaker::CoroutineWaker(lua_State *thread, int threadRef, QObject *parent)
+  : QObject(parent), thread_(thread), threadRef_(threadRef) {
+  timer_.setTimerType(Qt::PreciseTimer);
+  timer_.setSingleShot(true);
+  connect(&timer_, SIGNAL(timeout()), this, SLOT(expire()));
+}
+
+void CoroutineWaker::start(int timeout_ms) {
+  if (timeout_ms >= 0) {
+    timer_.start(timeout_ms);
+  }
+}
+
+void CoroutineWaker::wake() {
+  resume(true);
+}
+
+void CoroutineWaker::expire() {
+  resume(false);
+}
+
+void CoroutineWaker::resume(bool signaled) {
+  if (threadRef_ == LUA_NOREF) {
+    return;
+  }
+  timer_.stop();
+  // The reference has kept the coroutine alive while it was suspended
+  const int ref = threadRef_;
+  threadRef_ = LUA_NOREF;
+  lua_pushboolean(thread_, signaled);
+  resumeThread(thread_, 1);
+  luaL_unref(thread_, LUA_REGISTRYINDEX, ref);
+  // Destruction disconnects the awaited signal
+  deleteLater();
+}
+
+void CoroutineWaker::resumeThread(lua_State *thread, int nargs) {
+  const int res = lua_resume(thread, NULL, nargs);
+  if (res != LUA_OK && res != LUA_YIELD) {
+    std::cerr << "Lua error:" << std::endl << lua_tostring(thread, -1) << std::endl;
+    lua_settop(thread, 0);
+  }
+}
+
+namespace {
+// Registry key of the weak keyed set of coroutines started by async()
+const char *kAsyncThreads = "timers.AsyncThreads";
+}  // anonymous namespace
+
+void timers_mark_async(lua_State *L, int idx) {
+  idx = lua_absindex(L, idx);
+  lua_getfield(L, LUA_REGISTRYINDEX, kAsyncThreads);
+  lua_pushvalue(L, idx);
+  lua_pushboolean(L, 1);
+  lua_rawset(L, -3);
+  lua_pop(L, 1);
+}
+
+bool timers_in_async(lua_State *L) {
+  lua_getfield(L, LUA_REGISTRYINDEX, kAsyncThreads);
+  lua_pushthread(L);
+  lua_rawget(L, -2);
+  const bool async = lua_toboolean(L, -1);
+  lua_pop(L, 2);
+  return async;
+}
+
+CoroutineWaker* timers_create_waker(lua_State *L, int timeout_ms) {
+  lua_pushthread(L);
+  const int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  CoroutineWaker *waker = new CoroutineWaker(L, ref);
+  waker->start(timeout_ms);
+  return waker;
+}
+
+namespace {
+// Makes the running coroutine to be resumed by the signal of sender (if any) or timeout.
+// Returns false if sender has no such signal.
+// The caller returns lua_yield(L, 0) afterwards: it longjmps, so no C++ object
+// may be alive in the calling function at that point.
+bool resume_on_signal(lua_State *L, QObject *sender, const char *name, int timeout_ms) {
+  QByteArray signal;
+  if (sender) {
+    signal = QMetaObject::normalizedSignature(name);
+    if (sender->metaObject()->indexOfSignal(signal) < 0) {
+      return false;
+    }
+    // Signal code is required by string based QObject::connect
+    signal = "2" + signal;
+  }
+  CoroutineWaker *waker = timers_create_waker(L, timeout_ms);
+  if (sender) {
+    QObject::connect(sender, signal, waker, SLOT(wake()));
+  }
+  return true;
+}
+}  // anonymous namespace
+
+// timers.isAsync()
+// Returns true if the caller runs in a coroutine started by async(),
+// so it is able to wait by timers.sleepAsync and timers.waitFor.
+int timers_is_async(lua_State *L) {
+  lua_pushboolean(L, timers_in_async(L));
+  return 1;
+}
+
+// timers.sleepAsync(msec)
+// Delays the caller without blocking the event loop.
+// The calling coroutine started by async() is suspended and resumed later by the event loop.
+// A nested event loop is not used on the main thread: it would run queued slots,
+// e.g. the next test step, inside the caller, so the call is an error there.
+// Other coroutines are resumed by their own callers, the call is an error there too.
+int timers_sleep_async(lua_State *L) {
+  const int msec = luaL_checkinteger(L, 1);
+  if (!timers_in_async(L)) {
+    return luaL_error(L, "timers.sleepAsync: must be called from a coroutine started by async()");
+  }
+  resume_on_signal(L, NULL, NULL, msec);
+  return lua_yield(L, 0);
+}
+
+// timers.waitFor(object, signal[, msec])
+// Waits for the signal of a Qt object like timers.sleepAsync, msec limits the waiting time.
+// Returns true if the signal has been emitted, false on timeout.
+int timers_wait_for(lua_State *L) {
+  if (!timers_in_async(L)) {
+    return luaL_error(L, "timers.waitFor: must be called from a coroutine started by async()");
+  }
+  QObject *sender = lua_isuserdata(L, 1) ? *static_cast<QObject**>(lua_touserdata(L, 1)) : NULL;
+  luaL_argcheck(L, sender != NULL, 1, "qt object expected");
+  const char *name = luaL_checkstring(L, 2);
+  const int msec = luaL_optinteger(L, 3, -1);
+  if (!resume_on_signal(L, sender, name, msec)) {
+    return luaL_argerror(L, 2, "unknown signal");
+  }
+  return lua_yield(L, 0);
+}
 
 int timer_create(lua_State *L) {
   QTimer **p = static_cast<QTimer**>(lua_newuserdata(L, sizeof(QTimer*)));
@@ -89,8 +230,18 @@ int luaopen_timers(lua_State *L) {
 
   luaL_Reg timers_functions[] = {
     { "Timer", &timer_create },
+    { "sleepAsync", &timers_sleep_async },
+    { "waitFor", &timers_wait_for },
+    { "isAsync", &timers_is_async },
     { NULL, NULL }
   };
   luaL_newlib(L, timers_functions);
+
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_pushliteral(L, "k");
+  lua_setfield(L, -2, "__mode");
+  lua_setmetatable(L, -2);
+  lua_setfield(L, LUA_REGISTRYINDEX, kAsyncThreads);
   return 1;
 }
@@ -8,5 +8,38 @@ extern "C" {
 }
 #line 8 "timers.nw"
 #include <QObject>
+#include <QTimer>
+
+// Resumes a Lua coroutine suspended by timers.sleepAsync or timers.waitFor
+// when the awaited signal arrives or the timeout expires.
+// The coroutine receives true if it was woken by the signal, false on timeout.
+class CoroutineWaker : public QObject {
+  Q_OBJECT
+ public:
+  CoroutineWaker(lua_State *thread, int threadRef, QObject *parent = 0);
+  void start(int timeout_ms);
+  // Resumes the coroutine with nargs values from its stack, errors are reported to stderr
+  static void resumeThread(lua_State *thread, int nargs);
+ public slots:
+  void wake();
+ private slots:
+  void expire();
+ private:
+  void resume(bool signaled);
+
+  lua_State *thread_;
+  int threadRef_;
+  QTimer timer_;
+};
+
+// Creates a waker for the running coroutine of L. The caller connects the awaited signal
+// to wake() and returns lua_yield(L, 0).
+CoroutineWaker* timers_create_waker(lua_State *L, int timeout_ms);
+
+// Marks the coroutine at idx as started by async(): only such coroutines are resumed
+// by the event loop, others are resumed by their own callers and must not be suspended.
+void timers_mark_async(lua_State *L, int idx);
+// Returns true if the running coroutine of L has been started by async()
+bool timers_in_async(lua_State *L);
 
 int luaopen_timers(lua_State *L);
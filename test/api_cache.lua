@@ -0,0 +1,43 @@
+local xml_path = "test/out/api_cache.xml"
+local cache_path = xml_path .. ".cache"
+
+local function read(path)
+  local f = assert(io.open(path, "rb"))
+  local contents = f:read("*a")
+  f:close()
+  return contents
+end
+
+local function write(path, contents)
+  local f = assert(io.open(path, "wb"))
+  f:write(contents)
+  f:close()
+end
+
+write(xml_path, "<interfaces/>")
+os.remove(cache_path)
+print("miss: ", api_schema.load_cache(xml_path, cache_path))
+
+-- Members which can't be stored (functions, userdata) are skipped
+local tables = {
+  name = "Test",
+  params = { { name = "a", mandatory = true }, { name = "b", mandatory = false, maxlength = 100 } },
+  body = print
+}
+print("stored: ", api_schema.store_cache(xml_path, cache_path, tables))
+local cached = api_schema.load_cache(xml_path, cache_path)
+print("hit: ", cached.name, #cached.params, cached.params[1].name, cached.params[1].mandatory,
+  cached.params[2].mandatory, cached.params[2].maxlength, cached.body)
+
+local image = read(cache_path)
+write(cache_path, image:sub(1, #image - 4))
+print("truncated: ", api_schema.load_cache(xml_path, cache_path))
+write(cache_path, image)
+
+-- Cache built from another version of the XML is not used
+write(xml_path, "<interfaces></interfaces>")
+print("stale: ", api_schema.load_cache(xml_path, cache_path))
+
+os.remove(cache_path)
+os.remove(xml_path)
+quit()
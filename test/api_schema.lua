@@ -0,0 +1,81 @@
+-- Tables in the form built by api_loader: absent "mandatory" is true,
+-- attributes present in XML are kept as strings
+local function param(p_type, attrs)
+  local res = { type = p_type, mandatory = true, array = false }
+  for k, v in pairs(attrs or { }) do res[k] = v end
+  return res
+end
+
+local schema = api_schema.compile({
+  interface = {
+    Test = {
+      enum = {
+        Color = { RED = 0, GREEN = 1, BLUE = 2 }
+      },
+      struct = {
+        Point = { param = {
+          x = param("Integer"),
+          y = param("Integer"),
+          label = param("String", { mandatory = "false" })
+        } },
+        Shape = { param = {
+          origin = param("Point"),
+          color = param("Color", { mandatory = "false" })
+        } }
+      },
+      type = {
+        request = { functions = {
+          Draw = { param = {
+            shape = param("Shape"),
+            colors = param("Color", { mandatory = "false", array = "true", minsize = 1, maxsize = 3 }),
+            points = param("Test.Point", { mandatory = "false", array = "true" }),
+            name = param("String", { mandatory = "false" })
+          } }
+        } },
+        response = { functions = { } },
+        notification = { functions = { } }
+      }
+    }
+  }
+})
+
+-- Messages of parameters are printed in order of parameter names
+local function compare(title, data, function_id)
+  local result, errors = schema:Compare(function_id or "Draw", "request", data)
+  print(title .. ": ", result)
+  for name, messages in pairs(errors) do
+    if type(messages) == "string" then
+      print("", name, messages)
+    else
+      local params = { }
+      for param_name in pairs(messages) do table.insert(params, param_name) end
+      table.sort(params)
+      for _, param_name in ipairs(params) do
+        if messages[param_name] ~= "" then
+          print("", param_name .. ": " .. messages[param_name]:gsub("\n+$", ""))
+        end
+      end
+    end
+  end
+end
+
+local origin = { x = 1, y = 2 }
+compare("valid", { shape = { origin = origin, color = "RED" }, colors = { "RED", "BLUE" }, name = "a" })
+compare("missing member", { shape = { origin = { x = 1 } } })
+compare("unknown parameter", { shape = { origin = origin }, size = 3 })
+compare("numeric enum", { shape = { origin = origin, color = 1 }, colors = { 7 } })
+compare("invalid enum", { shape = { origin = origin, color = "PINK" } })
+compare("minsize", { shape = { origin = origin }, colors = { } })
+compare("maxsize", { shape = { origin = origin }, colors = { "RED", "GREEN", "BLUE", "RED" } })
+compare("not array", { shape = { origin = origin }, colors = "RED" })
+compare("no array sizes", { shape = { origin = origin }, points = { origin } })
+compare("nested member", { shape = { origin = { x = "1", y = 2 } } })
+compare("nested struct", { shape = { origin = 5 } })
+compare("array member", { shape = { origin = origin }, points = { origin, { x = 1, y = false } } })
+compare("unknown function", { }, "Erase")
+
+-- Lazy payloads are decoded before validation
+compare("lazy", json.lazy('{"shape":{"origin":{"x":1,"y":2}},"colors":["GREEN"]}'))
+print("malformed lazy: ", pcall(schema.Compare, schema, "Draw", "request", json.lazy('{"shape":')))
+compare("after error", { shape = { origin = origin } })
+quit()
@@ -0,0 +1,22 @@
+local timer = timers.Timer()
+timer:setSingleShot(true)
+local sender = qt.dynamic()
+local receiver = qt.dynamic()
+function receiver.ping()
+  print("ping received")
+end
+qt.connect(sender, "ping()", receiver, "ping()")
+
+async(function()
+  print("async: ", timers.isAsync(), coroutine.wrap(timers.isAsync)())
+  print("ping awaited: ", await(sender, "ping()"))
+end)
+async(function()
+  timer:start(10)
+  print("timer: ", await(timer))
+  sender:ping()
+  print("timeout: ", await(timer, "timeout()", 10))
+  quit()
+end)
+print("started: ", timers.isAsync())
+print(pcall(await, timer))
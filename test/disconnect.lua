@@ -0,0 +1,41 @@
+local sender = qt.dynamic()
+for _ = 1, 100 do
+  local d = qt.dynamic()
+  function d.pong(_, n) print("lost pong", n) end
+  qt.connect(sender, "ping(int)", d, "pong(int)")
+  qt.disconnect(sender, "ping(int)", d, "pong(int)")
+end
+print("after reconnects: ", qt.connections())
+
+local receiver = qt.dynamic()
+function receiver.pong(_, n)
+  print("pong", n)
+  -- Second queued call of the released slot is dropped
+  print("disconnect in slot: ", qt.disconnect(sender, "ping(int)", receiver, "pong(int)"))
+  print("in slot: ", qt.connections())
+end
+qt.connect(sender, "ping(int)", receiver, "pong(int)")
+qt.connect(sender, "ping(int)", receiver, "pong(int)")
+print("connected twice: ", qt.connections())
+print("unknown slot: ", qt.disconnect(sender, "ping(int)", receiver, "other(int)"))
+-- Failed connections release their slots
+print("incompatible slot: ", qt.connect(sender, "ping(int)", receiver, "pong(QString)"))
+print("unknown signal: ", qt.connect(timers.Timer(), "nosuch()", receiver, "pong()"))
+print("after failed connects: ", qt.connections())
+
+local timer = timers.Timer()
+qt.connect(timer, "timeout()", receiver, "timeout()")
+print("with timer: ", qt.connections())
+timer = nil
+collectgarbage()
+print("timer collected: ", qt.connections())
+
+local done = timers.Timer()
+done:setSingleShot(true)
+function receiver.timeout()
+  print("done: ", qt.connections())
+  quit()
+end
+qt.connect(done, "timeout()", receiver, "timeout()")
+sender:ping(1)
+done:start(20)
@@ -0,0 +1,55 @@
+config = { checkAllValidations = false }
+local expectations = require('expectations')
+local ed = require('event_dispatcher')
+local events = require('events')
+
+local connection = { }
+function connection:OnConnected() end
+function connection:OnDisconnected() end
+function connection:OnInputBatch(func) self.inputBatch = func end
+
+local dispatcher = ed.EventDispatcher()
+dispatcher:AddConnection(connection)
+
+local order = { }
+dispatcher:OnPreEvent(function(data) table.insert(order, "pre " .. data.name) end)
+dispatcher:OnPostEvent(function(data) table.insert(order, "post " .. data.name) end)
+
+local function expect(name, level, prefix)
+  local event = events.Event()
+  event.level = level
+  event.matches = function(_, data) return data.name:sub(1, 1) == prefix end
+  local exp = expectations.Expectation(name, connection)
+  exp.event = event
+  exp.validations = 0
+  local validate = exp.validate
+  function exp:validate()
+    self.validations = self.validations + 1
+    return validate(self)
+  end
+  exp:Do(function(_, data) table.insert(order, "do " .. data.name) end)
+  dispatcher:AddEvent(connection, event, exp)
+  return exp
+end
+
+local frames = expect("frames", 0, "f")
+local messages = expect("messages", 2, "m")
+
+-- Every frame is followed by the message it completes
+connection:inputBatch({
+  { name = "f1", _technical = { isFrame = true } },
+  { name = "m1", _technical = { } },
+  { name = "f2", _technical = { isFrame = true } },
+  { name = "m2", _technical = { } }
+})
+for _, entry in ipairs(order) do
+  print(entry)
+end
+print("occurences: ", frames.occurences, messages.occurences)
+print("validations: ", frames.validations, messages.validations)
+
+-- Handlers are not called for an empty batch
+order = { }
+connection:inputBatch({ })
+print("empty: ", #order)
+quit()
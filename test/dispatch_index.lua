@@ -0,0 +1,53 @@
+config = { checkAllValidations = false }
+local expectations = require('expectations')
+local ed = require('event_dispatcher')
+local events = require('events')
+
+local connection = { }
+function connection:OnConnected() end
+function connection:OnDisconnected() end
+function connection:OnInputData() end
+
+local dispatcher = ed.EventDispatcher()
+dispatcher:AddConnection(connection)
+
+local checked = { }
+local function expect(name, field, ...)
+  local values = table.pack(...)
+  local event = events.Event()
+  event.level = 2
+  event.matches = function(_, data)
+    table.insert(checked, name)
+    if not field then return data.any == name end
+    for i = 1, values.n do
+      if data[field] == values[i] then return true end
+    end
+    return false
+  end
+  if field then event:IndexBy(field, ...) end
+  local exp = expectations.Expectation(name, connection)
+  exp.event = event
+  dispatcher:AddEvent(connection, event, exp)
+  return exp
+end
+
+-- Only events indexed by a value of data and non-indexed events are checked
+local function find(data)
+  checked = { }
+  local exp = dispatcher:FindHandler(connection, data)
+  table.sort(checked)
+  print(exp and exp.name or "none", "checked: " .. table.concat(checked, ","))
+end
+
+local show = expect("Show", "rpcFunctionId", 13)
+expect("Responses", "rpcCorrelationId", 1, 2)
+expect("Other", nil)
+expect("NilValue", "rpcFunctionId", nil)
+
+find({ rpcFunctionId = 13 })
+find({ rpcCorrelationId = 2 })
+find({ rpcFunctionId = 14 })
+print(dispatcher:FindHandler(connection, { any = "Other" }).name)
+dispatcher:RemoveEvent(connection, show.event)
+find({ rpcFunctionId = 13 })
+quit()
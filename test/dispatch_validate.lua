@@ -0,0 +1,52 @@
+config = { checkAllValidations = false }
+local now = 1000
+function timestamp() return now end
+local expectations = require('expectations')
+local ed = require('event_dispatcher')
+local events = require('events')
+
+local connection = { }
+function connection:OnConnected() end
+function connection:OnDisconnected() end
+function connection:OnInputData() end
+
+local dispatcher = ed.EventDispatcher()
+dispatcher:AddConnection(connection)
+
+local function expect(name, timeout)
+  local event = events.Event()
+  event.level = 2
+  event.matches = function(_, data) return data.name == name end
+  local exp = expectations.Expectation(name, connection)
+  exp.event = event
+  exp:Timeout(timeout)
+  exp.validations = 0
+  local validate = exp.validate
+  function exp:validate()
+    self.validations = self.validations + 1
+    return validate(self)
+  end
+  dispatcher:AddEvent(connection, event, exp)
+  return exp
+end
+
+local statuses = { [expectations.SUCCESS] = "SUCCESS", [expectations.FAILED] = "FAILED" }
+local quick = expect("quick", 100)
+local slow = expect("slow", 300)
+local function report(title)
+  dispatcher:validateChanged()
+  print(title, quick.validations, statuses[quick.status], slow.validations, statuses[slow.status])
+end
+
+-- Added expectations are validated once, then only on occurrence or when the earliest timeout expires
+report("added:")
+report("unchanged:")
+dispatcher:RaiseEvent(connection, { name = "quick" })
+print("occurred:", quick.validations, statuses[quick.status], slow.validations, statuses[slow.status])
+now = 1200
+report("deadline:")
+now = 1250
+report("before deadline:")
+now = 1301
+report("timeout:")
+quit()
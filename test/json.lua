@@ -0,0 +1,20 @@
+local json = require("json")
+
+print(json.encode({ 1, "two", true, json.null }))
+print(json.encode({ }))
+print(json.encode(json.EMPTY_ARRAY))
+print(json.encode(json.EMPTY_OBJECT))
+print(json.encode({ params = { text = "a/b \"c\"\n" } }))
+print(json.encode({ [1] = 1, [3] = 3 }))
+
+local value = json.decode('{ "id": 12, "result": { "list": [1, null, "x\\u00e9"], "ok": false } }')
+print(value.id, value.result.ok, value.result.list[1], value.result.list[2], value.result.list[3])
+print(json.encode(json.decode('{"a":{"b":[]}}')))
+print(json.null == json.null())
+print(pcall(json.decode, '{"a":'))
+
+local text = '{"success":true,"resultCode":"SUCCESS","info":{"text":"x"}}'
+local payload = json.lazy(text)
+print(payload.success, payload.resultCode, json.encode(payload) == text)
+print(payload.info.text, getmetatable(payload))
+quit()
@@ -0,0 +1,69 @@
+-- Log levels decide which log files a message goes to before it is formatted
+local main_log = "test/out/logsink_levels.txt"
+local full_log = "test/out/logsink_levels_full.txt"
+
+local CONTROL_FRAME, SINGLE_FRAME = 0, 1
+local RPC, PCM, VIDEO = 7, 0x0A, 0x0B
+local HEARTBEAT, HEARTBEAT_ACK, START_SERVICE = 0x00, 0xFF, 0x01
+
+local function targets(sink)
+  local res = { }
+  local function add(name, value)
+    table.insert(res, name .. "=" .. value)
+  end
+  add("rpc", sink:mobile_targets("MOBtoSDL", SINGLE_FRAME, RPC, 0))
+  add("response", sink:mobile_targets("SDLtoMOB", SINGLE_FRAME, RPC, 0))
+  add("pcm", sink:mobile_targets("MOBtoSDL", SINGLE_FRAME, PCM, 0))
+  add("video", sink:mobile_targets("SDLtoMOB", SINGLE_FRAME, VIDEO, 0))
+  add("control", sink:mobile_targets("MOBtoSDL", CONTROL_FRAME, RPC, START_SERVICE))
+  add("heartbeat", sink:mobile_targets("MOBtoSDL", CONTROL_FRAME, 0, HEARTBEAT))
+  add("ack", sink:mobile_targets("SDLtoMOB", CONTROL_FRAME, 0, HEARTBEAT_ACK))
+  add("hmi", sink:hmi_targets("HMItoSDL"))
+  add("tohmi", sink:hmi_targets("SDLtoHMI"))
+  return table.concat(res, " ")
+end
+
+local sink = logsink.open(main_log)
+print("normal only: ", targets(sink))
+sink:close()
+
+sink = logsink.open(main_log, full_log)
+print("MAIN, FULL: ", logsink.MAIN, logsink.FULL)
+print("default: ", targets(sink))
+sink:set_levels{ heartbeat = "none", services = { [PCM] = "none", [VIDEO] = "normal" } }
+print("services: ", targets(sink))
+sink:set_levels{ MOBtoSDL = "normal", SDLtoHMI = "none" }
+print("tracts: ", targets(sink))
+sink:set_levels{ SDLtoMOB = "none", services = { [RPC] = "normal" } }
+print("lowest: ", targets(sink))
+sink:set_levels{ }
+print("reset: ", targets(sink))
+
+print("invalid level: ", pcall(sink.set_levels, sink, { HMItoSDL = "verbose" }))
+print("invalid service: ", pcall(sink.set_levels, sink, { services = { [256] = "none" } }))
+print("invalid tract: ", pcall(sink.hmi_targets, sink, "HMI"))
+print("kept: ", targets(sink))
+
+-- Only the targets returned are written
+sink:set_levels{ HMItoSDL = "normal", SDLtoHMI = "none" }
+local message = '{"method":"BasicCommunication.OnReady"}'
+for _, tract in ipairs({ "HMItoSDL", "SDLtoHMI" }) do
+  local to = sink:hmi_targets(tract)
+  if to ~= 0 then
+    sink:hmi(to, tract, message)
+  end
+end
+sink:close()
+
+local function lines(filename)
+  local count = 0
+  for line in io.lines(filename) do
+    if line:find(message, 1, true) then count = count + 1 end
+  end
+  return count
+end
+print("written: ", lines(main_log), lines(full_log))
+
+os.remove(main_log)
+os.remove(full_log)
+quit()
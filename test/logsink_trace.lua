@@ -0,0 +1,62 @@
+-- The same records are written to a text full log and to a binary trace,
+-- atf_trace renders the trace back to the text of the full log
+local text_log = "test/out/logsink_trace.txt"
+local trace_log = "test/out/logsink_trace.atftrace"
+local atf_trace = "./tools/atf_trace"
+
+local function write(sink)
+  local full = logsink.FULL
+  sink:text(full, "\n\n===== Start : \n")
+  sink:mobile(full, "MOB->SDL", "rpcFunction: RegisterAppInterface", 1, 3, 1, false, 7, 0, 65537, 0,
+    '{"appName":"Test"}')
+  sink:mobile(full, "SDL->MOB", "controlMsg: Heartbeat", 1, 3, 0, false, 0, 0, 4294967296, 2, nil)
+  sink:mobile(full, "MOB->SDL", "rpcFunction: PutFile", 2, 3, 1, true, 7, 0.5, 3, 3, "\0\1\2")
+  sink:hmi(full, "HMI->SDL", '{"method":"BasicCommunication.OnReady"}', true)
+  sink:hmi(full, "SDL->HMI", '{"method":"BasicCommunication.OnAppRegistered"}')
+  sink:mobile(full, "SDL->MOB", "rpcFunction: RegisterAppInterface", 1, 3, 1, false, 7, 0, 65537, 0,
+    '{"success":true}')
+  sink:text(full, "\n\n===== Total executing time is 1 =====\n")
+  sink:close()
+end
+
+-- Times of the two logs may differ
+local function strip_time(text)
+  return (text:gsub("%[%d+%-%d+%-%d+ %d+:%d+:%d+,%d+%]", "[time]"))
+end
+
+local function read(filename)
+  local file = io.open(filename, "rb")
+  local res = file:read("*a")
+  file:close()
+  return res
+end
+
+local function render(options, filename)
+  local pipe = io.popen(atf_trace .. " " .. options .. " " .. (filename or trace_log) .. " 2>&1")
+  local res = pipe:read("*a")
+  pipe:close()
+  return strip_time(res)
+end
+
+write(logsink.open(nil, text_log))
+write(logsink.open(nil, trace_log, "trace"))
+
+local text = strip_time(read(text_log))
+local rendered = render("")
+print("round trip: ", rendered == text)
+print("smaller: ", #read(trace_log) < #read(text_log))
+
+print("direction: ")
+io.write(render("-d 'SDL->HMI'"))
+print("function: ")
+io.write(render("-m -f RegisterAppInterface"))
+print("session: ")
+io.write(render("-s 2"))
+print("messages: ")
+io.write(render("-m -d 'HMI->SDL'"))
+print("not a trace: ")
+io.write(render("", text_log))
+
+os.remove(text_log)
+os.remove(trace_log)
+quit()
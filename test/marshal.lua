@@ -0,0 +1,37 @@
+local sender = qt.dynamic()
+local receiver = qt.dynamic()
+
+function receiver:values(i, n, b, s, ba)
+  print("values: ", i, n, b, s, #ba, ba == "a\0b")
+end
+function receiver:many(a1, a2, a3, a4, a5, a6, a7, a8, a9)
+  print("many: ", a1, a2, a3, a4, a5, a6, a7, a8, a9)
+end
+local received, total = 0, 0
+function receiver:text(s)
+  received = received + 1
+  total = total + #s
+end
+function receiver:done()
+  print("text: ", received, total)
+  quit()
+end
+
+local values = "values(int,qint64,bool,QString,QByteArray)"
+qt.connect(sender, values, receiver, values, qt.DirectConnection)
+qt.connect(sender, "queuedValues(int,qint64,bool,QString,QByteArray)", receiver, values)
+-- More arguments than fit in the stack storage of the emitter
+local many = "many(int,int,int,int,int,int,int,int,QString)"
+qt.connect(sender, many, receiver, many, qt.DirectConnection)
+qt.connect(sender, "text(QString)", receiver, "text(QString)")
+qt.connect(sender, "done()", receiver, "done()")
+
+sender:values(1, 4294967296, true, "direct", "a\0b")
+-- Queued arguments are copied before the emitter disposes them
+sender:queuedValues(2, -1, false, "queued", "a\0b")
+sender:many(1, 2, 3, 4, 5, 6, 7, 8, "ninth")
+for i = 1, 1000 do
+  sender:text(string.rep("x", i % 10))
+end
+sender:done()
+print("emitted")
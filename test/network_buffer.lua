@@ -0,0 +1,33 @@
+local buffer = network.Buffer()
+buffer:append("Hello, ")
+buffer:append("world")
+print(buffer:size(), buffer:sub(1, 5), buffer:sub(-5), tostring(buffer))
+buffer:clear()
+print(buffer:size(), buffer:tostring() == "")
+
+local server = network.TcpServer()
+local client = network.TcpClient()
+local input = qt.dynamic()
+local output = qt.dynamic()
+
+qt.connect(client, "readyRead()", input, "dataReady()")
+function input.dataReady()
+  -- Reads are appended behind the current contents of the buffer
+  print("Client read: ", client:read_into(buffer, 2), tostring(buffer))
+  print("Client read: ", client:read_into(buffer), tostring(buffer))
+  client:close()
+  quit()
+end
+
+if not server:listen("localhost", 5201) then
+  print("Listen failed")
+  quit(1)
+end
+
+qt.connect(server, "newConnection()", output, "newConnection()")
+function output.newConnection()
+  output.socket = server:get_connection()
+  output.socket:write("Hello")
+end
+
+client:connect("localhost", 5201)
@@ -0,0 +1,31 @@
+local server = network.TcpServer()
+local client = network.TcpClient()
+local failing = network.TcpClient()
+local input = qt.dynamic()
+
+qt.connect(client, "connected()", input, "connected()")
+qt.connect(failing, "connectFailed()", input, "failed()")
+
+function input.connected()
+  print("Client connected")
+  client:close()
+  -- Nobody listens on the port: attempts are repeated until the timeout
+  failing:connect_async("localhost", 5203, 100)
+end
+
+function input.failed()
+  print("Connect failed")
+  quit()
+end
+
+-- Connection is retried until the server starts listening
+local timer = timers.Timer()
+timer:setSingleShot(true)
+qt.connect(timer, "timeout()", input, "listen()")
+function input.listen()
+  print("Listen: ", server:listen("localhost", 5202))
+end
+timer:start(20)
+
+client:connect_async("localhost", 5202, 1000)
+print("Connecting")
@@ -0,0 +1,14 @@
+local server = network.TcpServer()
+local probe = network.ListenProbe()
+local input = qt.dynamic()
+
+qt.connect(probe, "ready()", input, "ready()")
+function input.ready()
+  print("Probe ready: ", probe:listening(5204))
+  quit()
+end
+
+print("Listening before listen: ", probe:listening(5204))
+-- ready() is emitted from the event loop once the port listens
+probe:start(5204)
+print("Listen: ", server:listen("localhost", 5204))
@@ -0,0 +1,36 @@
+local server = network.TcpServer()
+local client = network.TcpClient()
+local input = qt.dynamic()
+local output = qt.dynamic()
+
+qt.connect(client, "readyRead()", input, "dataReady()")
+function input.dataReady()
+  print("Client received: ", client:read_all())
+  client:close()
+  quit()
+end
+
+if not server:listen("localhost", 5206) then
+  print("Listen failed")
+  quit(1)
+end
+
+qt.connect(server, "newConnection()", output, "newConnection()")
+function output.newConnection()
+  output.socket = server:get_connection()
+  output.queue = output.socket:send_queue(4, 1)
+  qt.connect(output.queue, "writable()", output, "writable()", qt.DirectConnection)
+  qt.connect(output.queue, "drained()", output, "drained()", qt.DirectConnection)
+  local tail = network.Buffer()
+  tail:append("onse")
+  -- The high watermark is reached, the data is queued anyway
+  print("Server queue writable: ", output.queue:write_many({ "Resp", tail }), output.queue:in_flight())
+end
+function output.writable()
+  print("Server queue writable again: ", output.queue:writable())
+end
+function output.drained()
+  print("Server queue drained: ", (output.queue:stats()), output.queue:in_flight())
+end
+
+client:connect("localhost", 5206)
@@ -0,0 +1,24 @@
+local server = network.TcpServer()
+local client = network.TcpClient()
+local output = qt.dynamic()
+
+if not server:listen("localhost", 5205) then
+  print("Listen failed")
+  quit(1)
+end
+
+qt.connect(server, "newConnection()", output, "newConnection()")
+function output.newConnection()
+  output.socket = server:get_connection()
+  qt.connect(output.socket, "readyRead()", output, "dataReady()")
+end
+function output.dataReady()
+  print("Server received: ", output.socket:read_all())
+  quit()
+end
+
+client:connect("localhost", 5205)
+-- Strings and buffers are written with one call
+local tail = network.Buffer()
+tail:append(", world")
+print("Client written: ", client:write_many({ "Hel", "lo", tail }))
@@ -0,0 +1,32 @@
+local exited = process.spawn("/bin/sh", { "-c", "exit 3" })
+print(exited:wait(1000), exited:running(), exited:exitCode())
+
+local short = process.spawn("/bin/sleep", { "0.05" })
+print(pcall(timers.waitFor, short, "finished(int,int)", 1000))
+print(short:wait(1000), short:exitCode())
+
+local sleeping = process.spawn("/bin/sleep", { "10" }, { cwd = "/", stdout = "/dev/null" })
+print(sleeping:running(), sleeping:wait(10))
+local attached = process.attach(sleeping:pid())
+print(attached:running())
+
+local receiver = qt.dynamic()
+function receiver:finished(code, signal)
+  print("finished: ", code, signal)
+end
+qt.connect(sleeping, "finished(int,int)", receiver, "finished(int,int)")
+
+async(function()
+  print("resumed: ", timers.waitFor(sleeping, "finished(int,int)", 1000))
+  print(attached:wait(1000), process.attach(sleeping:pid()))
+  quit()
+end)
+print("suspended")
+print(pcall(timers.sleepAsync, 10))
+-- Coroutines not started by async() are resumed by their callers
+print(coroutine.wrap(function()
+  return pcall(timers.waitFor, sleeping, "finished(int,int)", 1000)
+end)())
+print(sleeping:kill(process.SIGTERM))
+
+print(process.spawn("./nonexistent"))
@@ -0,0 +1,53 @@
+local function int32(val)
+  return string.char(math.floor(val / 0x1000000) % 0x100, math.floor(val / 0x10000) % 0x100,
+                     math.floor(val / 0x100) % 0x100, val % 0x100)
+end
+
+local function frame(frameType, frameInfo, messageId, data)
+  return string.char(0x20 + frameType, 7, frameInfo, 1) .. int32(#data) .. int32(messageId) .. data
+end
+
+local parser = protocol.Parser()
+
+local stream = frame(1, 0, 1, "single") ..
+               frame(2, 0, 2, int32(11) .. int32(2)) ..
+               frame(3, 1, 2, "Hello ") ..
+               frame(3, 0, 2, "world")
+
+-- Feed the stream by small chunks to split frames between calls
+local frames = { }
+for i = 1, #stream, 5 do
+  for _, msg in ipairs(parser:parse(string.sub(stream, i, i + 4))) do
+    table.insert(frames, msg)
+  end
+end
+print("Frames parsed: " .. #frames)
+
+for _, msg in ipairs(frames) do
+  print(string.format("version=%d frameType=%d serviceType=%d frameInfo=%d sessionId=%d messageId=%d size=%d",
+    msg.version, msg.frameType, msg.serviceType, msg.frameInfo, msg.sessionId, msg.messageId, msg.size))
+  if msg.frameType == 1 then
+    print("Single frame: " .. msg.binaryData)
+  elseif parser:assemble(msg) then
+    print("Assembled message: " .. msg.binaryData)
+  end
+end
+
+print("Incomplete frame: " .. #parser:parse(string.sub(frame(1, 0, 3, "tail"), 1, 14)))
+print("Completed frame: " .. parser:parse("il")[1].binaryData)
+
+local message = { version = 2, encryption = false, frameType = 1, serviceType = 7, frameInfo = 0,
+                  sessionId = 1, messageId = 4, binaryData = string.rep("x", 40) }
+local composed = protocol.compose(message, 32)
+print("Frames composed: " .. #composed)
+print("Contiguous size: " .. #protocol.compose(message, 32, true))
+local assembled
+for _, msg in ipairs(parser:parse(table.concat(composed))) do
+  if parser:assemble(msg) then assembled = msg.binaryData end
+end
+print("Round trip: " .. tostring(assembled == message.binaryData))
+
+local buffer = network.Buffer()
+buffer:append(frame(1, 0, 5, "from buffer"))
+print("Buffer frame: " .. parser:parse(buffer)[1].binaryData)
+quit()
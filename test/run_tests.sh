@@ -20,9 +20,28 @@ run_test()
 run_test "Dynamic object test" dynamic 3
 run_test "Signal-Slot mechanism example" signal_slot 3
 run_test "Qt Connect test" connect 3
+run_test "Qt Disconnect test" disconnect 3
+run_test "Signal marshalling test" marshal 3
 run_test "Network test" network 3
+run_test "Network buffer test" network_buffer 3
+run_test "Network async connect test" network_connect 3
+run_test "Listen probe test" network_probe 3
+run_test "Network write_many test" network_write_many 3
+run_test "Network send queue test" network_send_queue 3
+run_test "Protocol parser test" protocol 3
+run_test "JSON codec test" json 3
+run_test "ATF trace test" logsink_trace 3
+run_test "ATF log levels test" logsink_levels 3
+run_test "Process test" process 3
+run_test "Coroutine await test" async 3
+run_test "Event dispatcher batch test" dispatch_batch 3
+run_test "Event dispatcher index test" dispatch_index 3
+run_test "Event dispatcher validation test" dispatch_validate 3
 run_test "Xml test" xmltest 3
+run_test "Xml stream test" xmlstream 3
 run_test "Validation test" validationTest 3
+run_test "Compiled API schema test" api_schema 3
+run_test "API schema cache test" api_cache 3
 run_test "Report test" reportTest 3
 run_test "SDL log test: " SDLLogTest  3 ./modules/launch.lua "--storeFullSDLLogs"
 #../interp testbase.lua
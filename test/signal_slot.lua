@@ -4,6 +4,12 @@ function sender:signal() end
 function receiver:test(s)
   print("receiver.test(): ", s)
 end
+function receiver:direct(s)
+  print("receiver.direct(): ", s)
+end
+function receiver:count(n)
+  print("receiver.count(): ", n)
+end
 function receiver:quit(s)
   quit()
 end
@@ -11,6 +17,13 @@ qt.connect(sender, "signal(QString)", receiver, "test(QString)")
 qt.connect(sender, "signal(QString)", receiver, "test(QString)")
 qt.connect(sender, "signal(QString)", receiver, "test(QString)")
 qt.connect(sender, "quit()", receiver, "quit()")
+qt.connect(sender, "directSignal(QString)", receiver, "direct(QString)", qt.DirectConnection)
+qt.connect(sender, "directCount(int)", receiver, "count(int)", qt.DirectConnection)
 
 sender:signal("hello")
+sender:directSignal("now")
+-- Missing arguments are delivered as default values
+sender:directSignal()
+sender:directCount(nil)
+print("direct signal emitted")
 sender:quit()
@@ -1,3 +1,4 @@
+config = { ValidateSchema = true }
 local validator = require("schema_validation")
 
 local load_schema = require("load_schema")
@@ -5,6 +6,14 @@ local load_schema = require("load_schema")
 local mob_schema = load_schema.mob_schema
 local hmi_schema = load_schema.hmi_schema
 
+-- Messages of parameters come in table order, they are printed sorted
+local function sorted(err)
+  local lines = { }
+  for line in err:gmatch("[^\n]+") do table.insert(lines, line) end
+  table.sort(lines)
+  return table.concat(lines, "\n")
+end
+
 local json_hmi_tbl = { numTicks = 7, position = 6, sliderHeader ="sliderHeader",
   sliderFooter =
   {
@@ -226,21 +235,21 @@ local _res, _err = hmi_schema:Validate('UI.GetCapabilities', 'response', json_ca
 if _res then
   print("validate_hmi_response UI.GetCapabilities:"..tostring(_res))
 else
-  print("validate_hmi_response UI.GetCapabilities:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_response UI.GetCapabilities:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 local _res, _err = hmi_schema:Validate('Buttons.GetCapabilities',  'response', json_hmi_ButtonCapabilities_tbl2)
 if _res then
   print("validate_hmi_response Buttons.GetCapabilities:"..tostring(_res))
 else
-  print("validate_hmi_response Buttons.GetCapabilities:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_response Buttons.GetCapabilities:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 local _res, _err = hmi_schema:Validate('UI.Slider',  'request', json_hmi_tbl) 
 if _res then
   print("validate_hmi_request:"..tostring(_res))
 else
-  print("validate_hmi_request:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_request:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 
@@ -248,7 +257,7 @@ _res, _err = mob_schema:Validate('Slider', 'response',  { success = true, result
 if _res then
   print("validate_mobile_response:"..tostring(_res))
 else
-  print("validate_mobile_response:"..tostring(_res).." ==> ".._err)
+  print("validate_mobile_response:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 
@@ -256,21 +265,21 @@ _res, _err = mob_schema:Validate("WrongFunctionName", "response", { success = fa
 if _res then
   print("validate_mobile_response with \"WrongFunctionName\":"..tostring(_res))
 else
-  print("validate_mobile_response with \"WrongFunctionName\":"..tostring(_res).." ==> ".._err)
+  print("validate_mobile_response with \"WrongFunctionName\":"..tostring(_res).." ==> "..sorted(_err))
 end
 
 _res, _err = hmi_schema:Validate("BasicCommunication.OnSystemRequest", 'notification',  { requestType = "PROPRIETARY"})
 if _res then
   print("validate_hmi_notification:"..tostring(_res))
 else
-  print("validate_hmi_notification:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_notification:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 _res, _err = hmi_schema:Validate('BasicCommunication.OnSystemRequest', "notification", { url = "default", fileName = "fileName"}, true)
 if _res then
   print("validate_hmi_notification:"..tostring(_res))
 else
-  print("validate_hmi_notification:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_notification:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 _res, _err =mob_schema:Validate("PerformInteraction", "request",  { initialText = "initialText",
@@ -283,7 +292,7 @@ _res, _err =mob_schema:Validate("PerformInteraction", "request",  { initialText
 if _res then
   print("validate_mobile_request:"..tostring(_res))
 else
-  print("validate_mobile_request:"..tostring(_res).." ==> ".._err)
+  print("validate_mobile_request:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 
@@ -293,7 +302,7 @@ _res, _err =mob_schema:Validate("OnHMIStatus", "notification", {hmiLevel = "FULL
 if _res then
   print("validate_modile_notification:"..tostring(_res))
 else
-  print("validate_mobile_notification:"..tostring(_res).." ==> ".._err)
+  print("validate_mobile_notification:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 print("======================= Negative case \n")
@@ -301,7 +310,7 @@ _res, _err = mob_schema:Validate('Slider', 'response',  { success = 'true', resu
 if _res then
   print("validate_mobile_response:"..tostring(_res))
 else
-  print("validate_mobile_response:"..tostring(_res).." ==> ".._err)
+  print("validate_mobile_response:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 print("======================= Negative case \n")
@@ -309,7 +318,7 @@ local _res, _err = hmi_schema:Validate('Buttons.GetCapabilities', 'response', js
 if _res then
   print("validate_hmi_request:"..tostring(_res))
 else
-  print("validate_hmi_request:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_request:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 
@@ -318,7 +327,7 @@ local _res, _err = hmi_schema:Validate('Buttons.GetCapabilities', 'response', js
 if _res then
   print("validate_hmi_response Buttons.GetCapabilities:"..tostring(_res))
 else
-  print("validate_hmi_response Buttons.GetCapabilities:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_response Buttons.GetCapabilities:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 print("======================= Negative case \n")
@@ -326,7 +335,7 @@ _res, _err = mob_schema:Validate('Slider', 'response', json_mob_tbl, true)
 if _res then
   print("validate_mobile_response:"..tostring(_res))
 else
-  print("validate_mobile_response:"..tostring(_res).." ==> ".._err)
+  print("validate_mobile_response:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 print("======================= Negative case \n")
@@ -334,7 +343,7 @@ local _res, _err = hmi_schema:Validate('UI.GetCapabilities', 'response', json_ca
 if _res then
   print("validate_hmi_response UI.GetCapabilities:"..tostring(_res))
 else
-  print("validate_hmi_response UI.GetCapabilities:"..tostring(_res).." ==> ".._err)
+  print("validate_hmi_response UI.GetCapabilities:"..tostring(_res).." ==> "..sorted(_err))
 end
 
 quit()
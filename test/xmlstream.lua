@@ -0,0 +1,58 @@
+xml = require("xml")
+config = { excludeReport = false, reportPath = "test/out" }
+xmlReporter = require("reporter")
+
+-- Reads the report file back, it has to be a well-formed document
+local function steps(filename)
+  local doc = xml.open(filename)
+  if not doc then return "not well-formed" end
+  local res = { }
+  for _, step in ipairs(doc:xpath("/*/*")) do
+    local messages = { }
+    for _, msg in ipairs(step:children()) do
+      table.insert(messages, msg:name())
+    end
+    table.insert(res, step:name() .. "(" .. tostring(step:attr("result")) .. ": " .. table.concat(messages, ",") .. ")")
+  end
+  return table.concat(res, " ")
+end
+
+local stream = xml.stream("test/out/xmlstream.xml", "root")
+print("empty: ", steps("test/out/xmlstream.xml"))
+local doc = xml.new()
+local root = doc:createRootNode("doc")
+local first = root:addChild("first")
+stream:write(first)
+print("pending: ", steps("test/out/xmlstream.xml"))
+stream:flush()
+print("flushed: ", steps("test/out/xmlstream.xml"))
+first:addChild("late")
+first:addChild("later")
+stream:rewrite(first)
+stream:flush()
+print("rewritten: ", steps("test/out/xmlstream.xml"))
+stream:rewrite(root:addChild("second"))
+stream:flush()
+print("shrunk: ", steps("test/out/xmlstream.xml"))
+stream:close()
+os.remove("test/out/xmlstream.xml")
+
+xmlReporter.init("test/xmlstream.lua")
+local report = xmlReporter.curr_report_name
+xmlReporter.AddCase("Passed")
+xmlReporter.CaseMessageTotal("Passed", { result = true })
+xmlReporter.AddCase("Failed")
+xmlReporter.AddMessage("StopSDL", { message = "SDL stopped" })
+xmlReporter.AddMessage("ErrorMessage", { Status = "FAILED" }, { "error" })
+xmlReporter.CaseMessageTotal("Failed", { result = false })
+-- ATF is aborted: the report is not finalized
+print("aborted: ", steps(report))
+xmlReporter.AddMessage("StopSDL", { message = "SDL stopped" })
+xmlReporter.flush()
+print("flushed: ", steps(report))
+xmlReporter.AddCase("Skipped")
+xmlReporter.flush()
+print("skipped: ", steps(report))
+os.remove(report)
+os.remove(report:match("(.*)/[^/]*$"))
+quit()
@@ -0,0 +1,12 @@
+--- Script which builds API schema cache files for Mobile and HMI APIs
+--
+-- Usage: ./ATF tools/build_api_cache.lua
+--
+-- Cache is built anyway on the first ATF run, this script allows to build it beforehand
+-- for ATF instances started from copies of ATF directory (e.g. by `atf_parallels`).
+
+local api_loader = require('api_loader')
+
+api_loader.init("data/MOBILE_API.xml")
+api_loader.init("data/HMI_API.xml")
+quit()
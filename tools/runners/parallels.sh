@@ -89,6 +89,7 @@ function prepare_atf {
   #     1) ATF is copied to tmp dir (not to break an existing one)
   #     2) Copy required dirs from sdl_atf_test_scripts to sdl_atf
   #     3) Copy interfaces (MOBILE_API.xml, HMI_API.xml) to atf data dir
+  #        and build API schema cache for them
   #     4) Set required properties to ATF configuration file.
   #
 
@@ -135,6 +136,9 @@ function prepare_atf {
   if [ -n "$_path_sdl_mobile_api" ]; then cp $_path_sdl_mobile_api/*.xml $atf_tmp_dir/data; fi
   if [ -n "$_path_sdl_hmi_api" ]; then cp $_path_sdl_hmi_api/*.xml $atf_tmp_dir/data; fi
 
+  # Build API schema cache once for all jobs
+  (cd $atf_tmp_dir && ./ATF tools/build_api_cache.lua > /dev/null 2>&1) || log "Unable to build API schema cache"
+
   sed -i '/^config.pathToSDL\ =/c\config.pathToSDL="/home/developer/sdl/bin"' $config_file
   sed -i '/^config.pathToSDLMobileInterface\ =/c\config.pathToSDLMobileInterface="/home/developer/sdl/atf/data"' $config_file
   sed -i '/^config.pathToSDLHMIInterface\ =/c\config.pathToSDLHMIInterface="/home/developer/sdl/atf/data"' $config_file